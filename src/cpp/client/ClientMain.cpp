@@ -1,5 +1,5 @@
 // ClientMain.cpp - Mini-3 client implementation
-// Supports Strategy B (GetNextChunk) for sequential chunk retrieval
+// Supports Strategy B (GetNextChunk) for sequential chunk retrieval, or FetchChunks streaming
 // Used by: test_real_data.sh, run_multi_clients.sh
 
 #include <grpcpp/grpcpp.h>
@@ -10,6 +10,7 @@
 #include <iomanip>
 #include <thread>
 #include <vector>
+#include <string>
 
 // Helper to create channel with increased message size limits (1.5GB for very large datasets)
 std::shared_ptr<grpc::Channel> CreateChannelWithLimits(const std::string& target) {
@@ -68,8 +69,61 @@ void testOpenSession(const std::string& target) {
     }
 }
 
+// Priority class plus a deadline `relative_deadline_ms` from now (0 = none)
+void setScheduling(mini2::Request& req, mini2::Priority priority, int64_t relative_deadline_ms) {
+    req.set_priority(priority);
+    if (relative_deadline_ms > 0) {
+        req.set_deadline_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count() + relative_deadline_ms);
+    }
+}
+
+// Automatic resume after a dropped connection: attempts per download, first backoff
+constexpr int kMaxResumes = 5;
+constexpr std::chrono::milliseconds kResumeBackoff{200};
+
+// Failures where the gateway may still hold the session; anything else is a real answer
+bool isConnectionLoss(const grpc::Status& status) {
+    return status.error_code() == grpc::StatusCode::UNAVAILABLE ||
+           status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED ||
+           status.error_code() == grpc::StatusCode::ABORTED;
+}
+
+// Reconnects and asks the gateway to pick the session up at `token` (the last
+// continuation received). On success `token` says where to continue.
+bool resumeSession(const std::string& gateway, std::unique_ptr<mini2::ClientGateway::Stub>& stub,
+                   const grpc::Status& failure, mini2::ContinuationToken& token, int& resumes) {
+    if (!isConnectionLoss(failure)) return false;
+    while (resumes < kMaxResumes) {
+        auto backoff = kResumeBackoff * (1 << resumes);
+        resumes++;
+        std::cout << "Connection lost (" << failure.error_message() << "); resuming at chunk "
+                  << token.chunk_index() << " in " << backoff.count() << " ms (attempt "
+                  << resumes << "/" << kMaxResumes << ")" << std::endl;
+        std::this_thread::sleep_for(backoff);
+        
+        stub = mini2::ClientGateway::NewStub(CreateChannelWithLimits(gateway));
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
+        mini2::ResumeResp resp;
+        auto status = stub->ResumeSession(&ctx, token, &resp);
+        if (status.ok()) {
+            if (!resp.ok()) {
+                std::cerr << "Cannot resume session: " << resp.error() << std::endl;
+                return false;
+            }
+            token = resp.resume_at();
+            return true;
+        }
+        if (!isConnectionLoss(status)) return false;
+    }
+    return false;
+}
+
 // Strategy B: GetNext (sequential pull)
-void testStrategyB_GetNext(const std::string& gateway, const std::string& dataset_path = "") {
+void testStrategyB_GetNext(const std::string& gateway, const std::string& dataset_path = "",
+                           mini2::Priority priority = mini2::PRIORITY_NORMAL, int64_t deadline_ms = 0,
+                           mini2::DeliveryMode delivery = mini2::DELIVERY_ORDERED) {
     std::cout << "\n========================================" << std::endl;
     std::cout << "Testing Strategy B: GetNext (Sequential)" << std::endl;
     std::cout << "========================================\n" << std::endl;
@@ -88,6 +142,8 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
     req.set_query(dataset_path);
     req.set_need_green(true);
     req.set_need_pink(true);
+    setScheduling(req, priority, deadline_ms);
+    req.set_delivery(delivery);
     
     mini2::SessionOpen session;
     auto start_session = std::chrono::high_resolution_clock::now();
@@ -99,8 +155,16 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
         std::cerr << "FAILED: StartRequest - " << status.error_message() << std::endl;
         return;
     }
+    if (!session.accepted()) {
+        std::cerr << "REJECTED: gateway is at capacity, retry in ~" << session.eta_ms() << " ms" << std::endl;
+        return;
+    }
     
-    std::cout << "Session started: " << session.request_id() << std::endl;
+    std::cout << "Session started: " << session.request_id() << " (" << session.status();
+    if (session.status() == "QUEUED") {
+        std::cout << " at position " << session.queue_position() << ", eta " << session.eta_ms() << " ms";
+    }
+    std::cout << ")" << std::endl;
     std::cout << "  Session creation time: " << session_latency.count() << " ms" << std::endl;
     std::cout << std::endl;
     
@@ -108,6 +172,9 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
     std::cout << "Step 2: Retrieving chunks sequentially..." << std::endl;
     uint32_t index = 0;
     uint64_t total_bytes = 0;
+    mini2::ContinuationToken token;  // last position the gateway confirmed
+    token.set_session_id(session.request_id());
+    int resumes = 0;
     auto start_chunks = std::chrono::high_resolution_clock::now();
     auto first_chunk_time = std::chrono::high_resolution_clock::time_point();
     
@@ -119,6 +186,7 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
         mini2::NextChunkReq next_req;
         next_req.set_request_id(session.request_id());
         next_req.set_next_index(index);
+        next_req.set_byte_offset(token.byte_offset());
         
         mini2::NextChunkResp resp;
         auto start_chunk = std::chrono::high_resolution_clock::now();
@@ -130,9 +198,14 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
         }
         
         if (!status.ok()) {
+            if (resumeSession(gateway, stub, status, token, resumes)) {
+                index = token.chunk_index();
+                continue;
+            }
             std::cerr << "GetNext failed: " << status.error_message() << std::endl;
             break;
         }
+        token = resp.continuation();
         
         if (!resp.has_more() && resp.chunk().empty()) {
             std::cout << "No more chunks available" << std::endl;
@@ -142,7 +215,7 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
         total_bytes += resp.chunk().size();
         auto chunk_latency = std::chrono::duration_cast<std::chrono::milliseconds>(end_chunk - start_chunk);
         
-        std::cout << "Chunk " << index 
+        std::cout << "Chunk " << index << " (part " << resp.part_index() << ")"
                   << ": " << resp.chunk().size() << " bytes"
                   << " (latency: " << chunk_latency.count() << " ms)"
                   << " (has_more: " << (resp.has_more() ? "yes" : "no") << ")" << std::endl;
@@ -166,11 +239,14 @@ void testStrategyB_GetNext(const std::string& gateway, const std::string& datase
     std::cout << "Time to first chunk: " << time_to_first_chunk.count() << " ms  " << std::endl;
     std::cout << "Total time: " << total_time.count() << " ms" << std::endl;
     std::cout << "RPC calls made: " << (1 + index) << " (1 StartRequest + " << index << " GetNext)" << std::endl;
+    std::cout << "Resumed after connection loss: " << resumes << " time(s)" << std::endl;
     std::cout << "========================================\n" << std::endl;
 }
 
 // Strategy B: PollNext (polling)
-void testStrategyB_PollNext(const std::string& gateway, const std::string& dataset_path = "") {
+void testStrategyB_PollNext(const std::string& gateway, const std::string& dataset_path = "",
+                            mini2::Priority priority = mini2::PRIORITY_NORMAL, int64_t deadline_ms = 0,
+                            mini2::DeliveryMode delivery = mini2::DELIVERY_ORDERED) {
     std::cout << "\n========================================" << std::endl;
     std::cout << "Testing Strategy B: PollNext (Polling)" << std::endl;
     std::cout << "========================================\n" << std::endl;
@@ -186,6 +262,8 @@ void testStrategyB_PollNext(const std::string& gateway, const std::string& datas
     req.set_query(dataset_path);
     req.set_need_green(true);
     req.set_need_pink(true);
+    setScheduling(req, priority, deadline_ms);
+    req.set_delivery(delivery);
     
     mini2::SessionOpen session;
     auto start_session = std::chrono::high_resolution_clock::now();
@@ -195,8 +273,13 @@ void testStrategyB_PollNext(const std::string& gateway, const std::string& datas
         std::cerr << "StartRequest failed: " << status.error_message() << std::endl;
         return;
     }
+    if (!session.accepted()) {
+        std::cerr << "StartRequest rejected: gateway is at capacity, retry in ~" 
+                  << session.eta_ms() << " ms" << std::endl;
+        return;
+    }
     
-    std::cout << "Session started: " << session.request_id() << std::endl;
+    std::cout << "Session started: " << session.request_id() << " (" << session.status() << ")" << std::endl;
     std::cout << std::endl;
     
     // Poll for chunks
@@ -205,6 +288,9 @@ void testStrategyB_PollNext(const std::string& gateway, const std::string& datas
     uint64_t total_bytes = 0;
     int poll_count = 0;
     auto first_chunk_time = std::chrono::high_resolution_clock::time_point();
+    mini2::ContinuationToken token;  // last position the gateway confirmed
+    token.set_session_id(session.request_id());
+    int resumes = 0;
     
     while (true) {
         grpc::ClientContext ctx2;
@@ -216,11 +302,14 @@ void testStrategyB_PollNext(const std::string& gateway, const std::string& datas
         poll_count++;
         
         if (!status.ok()) {
+            // The gateway moves its poll cursor back to the token, so a lost reply is served again
+            if (resumeSession(gateway, stub, status, token, resumes)) continue;
             std::cerr << "PollNext failed: " << status.error_message() << std::endl;
             break;
         }
         
         if (resp.ready()) {
+            token = resp.continuation();
             if (chunks_received == 0) {
                 first_chunk_time = std::chrono::high_resolution_clock::now();
             }
@@ -228,7 +317,7 @@ void testStrategyB_PollNext(const std::string& gateway, const std::string& datas
             total_bytes += resp.chunk().size();
             chunks_received++;
             
-            std::cout << "Chunk " << chunks_received 
+            std::cout << "Chunk " << chunks_received << " (part " << resp.part_index() << ")"
                       << ": " << resp.chunk().size() << " bytes"
                       << " (has_more: " << (resp.has_more() ? "yes" : "no") << ")" << std::endl;
         } else {
@@ -253,6 +342,162 @@ void testStrategyB_PollNext(const std::string& gateway, const std::string& datas
     std::cout << "Time to first chunk: " << time_to_first_chunk.count() << " ms  " << std::endl;
     std::cout << "Total time: " << total_time.count() << " ms" << std::endl;
     std::cout << "RPC calls made: " << (1 + poll_count) << " (1 StartRequest + " << poll_count << " PollNext)" << std::endl;
+    std::cout << "Resumed after connection loss: " << resumes << " time(s)" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+}
+
+// One FetchChunks download, for the window sweep
+struct StreamRun {
+    bool ok = false;
+    uint32_t chunks = 0;
+    uint64_t bytes = 0;
+    int64_t total_ms = 0;   // from StartRequest
+    int64_t stream_ms = 0;  // first chunk to last: the transfer alone
+};
+
+// Strategy B: FetchChunks (gateway pushes up to `window` chunks ahead of the client)
+StreamRun testStrategyB_Stream(const std::string& gateway, const std::string& dataset_path = "",
+                               mini2::Priority priority = mini2::PRIORITY_NORMAL, int64_t deadline_ms = 0,
+                               mini2::DeliveryMode delivery = mini2::DELIVERY_ORDERED,
+                               uint32_t window = 8, bool print_chunks = true) {
+    StreamRun run;
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "Testing Strategy B: FetchChunks (window " << window << ")" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+    
+    auto channel = CreateChannelWithLimits(gateway);
+    std::unique_ptr<mini2::ClientGateway::Stub> stub = mini2::ClientGateway::NewStub(channel);
+    
+    // Start request
+    std::cout << "Step 1: Starting session..." << std::endl;
+    grpc::ClientContext ctx1;
+    ctx1.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+    
+    mini2::Request req;
+    req.set_request_id("test-strategyB-stream");
+    req.set_query(dataset_path);
+    req.set_need_green(true);
+    req.set_need_pink(true);
+    setScheduling(req, priority, deadline_ms);
+    req.set_delivery(delivery);
+    
+    mini2::SessionOpen session;
+    auto start_session = std::chrono::high_resolution_clock::now();
+    auto status = stub->StartRequest(&ctx1, req, &session);
+    
+    if (!status.ok()) {
+        std::cerr << "FAILED: StartRequest - " << status.error_message() << std::endl;
+        return run;
+    }
+    if (!session.accepted()) {
+        std::cerr << "REJECTED: gateway is at capacity, retry in ~" << session.eta_ms() << " ms" << std::endl;
+        return run;
+    }
+    std::cout << "Session started: " << session.request_id() << " (" << session.status() << ")" << std::endl;
+    std::cout << std::endl;
+    
+    // Open the stream with the whole window, then hand one credit back per chunk read
+    std::cout << "Step 2: Streaming chunks..." << std::endl;
+    mini2::ContinuationToken token;  // last position the gateway confirmed
+    token.set_session_id(session.request_id());
+    int resumes = 0;
+    int streams = 0;
+    bool last_seen = false;
+    auto first_chunk_time = std::chrono::high_resolution_clock::time_point();
+    
+    while (true) {
+        grpc::ClientContext ctx2;
+        ctx2.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(600));
+        auto stream = stub->FetchChunks(&ctx2);
+        streams++;
+        
+        mini2::ChunkCredit credit;
+        credit.set_request_id(session.request_id());
+        credit.set_start_index(token.chunk_index());
+        credit.set_byte_offset(token.byte_offset());
+        credit.set_credits(window);
+        stream->Write(credit);
+        
+        mini2::ChunkCredit ack;
+        ack.set_credits(1);
+        mini2::NextChunkResp resp;
+        while (stream->Read(&resp)) {
+            token = resp.continuation();
+            if (run.chunks == 0) {
+                first_chunk_time = std::chrono::high_resolution_clock::now();
+            }
+            run.bytes += resp.chunk().size();
+            if (print_chunks) {
+                std::cout << "Chunk " << run.chunks << " (part " << resp.part_index() << ")"
+                          << ": " << resp.chunk().size() << " bytes"
+                          << " (has_more: " << (resp.has_more() ? "yes" : "no") << ")" << std::endl;
+            }
+            run.chunks++;
+            
+            if (!resp.has_more()) {
+                last_seen = true;
+                break;
+            }
+            stream->Write(ack);
+        }
+        stream->WritesDone();
+        status = stream->Finish();
+        
+        if (last_seen || status.ok()) break;
+        if (resumeSession(gateway, stub, status, token, resumes)) continue;
+        std::cerr << "FetchChunks failed: " << status.error_message() << std::endl;
+        break;
+    }
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
+    run.ok = last_seen || status.ok();
+    run.total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_session).count();
+    if (run.chunks > 0) {
+        run.stream_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - first_chunk_time).count();
+    }
+    auto time_to_first_chunk = std::chrono::duration_cast<std::chrono::milliseconds>(first_chunk_time - start_session);
+    
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "Strategy B (FetchChunks) Results:" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Window: " << window << " chunks" << std::endl;
+    std::cout << "Total chunks: " << run.chunks << std::endl;
+    std::cout << "Total bytes: " << run.bytes << std::endl;
+    std::cout << "Time to first chunk: " << time_to_first_chunk.count() << " ms  " << std::endl;
+    std::cout << "Total time: " << run.total_ms << " ms" << std::endl;
+    std::cout << "RPC calls made: " << (1 + streams) << " (1 StartRequest + " << streams << " FetchChunks)" << std::endl;
+    std::cout << "Resumed after connection loss: " << resumes << " time(s)" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+    return run;
+}
+
+// Runs the same query once per window size and prints throughput against window.
+// Window 1 is one chunk in flight at a time, i.e. what sequential GetNext gives.
+// An untimed first run fills the gateway's result cache, so every window is served
+// the same way, and throughput counts from the first chunk to the last.
+void testWindowSweep(const std::string& gateway, const std::string& dataset_path,
+                     mini2::Priority priority, int64_t deadline_ms, mini2::DeliveryMode delivery) {
+    const std::vector<uint32_t> windows = {1, 2, 4, 8, 16, 32};
+    std::cout << "Warm-up run (not timed)..." << std::endl;
+    testStrategyB_Stream(gateway, dataset_path, priority, deadline_ms, delivery, 8, false);
+    
+    std::vector<std::pair<uint32_t, StreamRun>> runs;
+    for (uint32_t window : windows) {
+        runs.emplace_back(window, testStrategyB_Stream(gateway, dataset_path, priority, deadline_ms,
+                                                       delivery, window, false));
+    }
+    
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "Throughput vs prefetch window" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << std::setw(8) << "window" << std::setw(10) << "chunks" << std::setw(14) << "bytes"
+              << std::setw(10) << "ms" << std::setw(10) << "MB/s" << std::endl;
+    for (const auto& [window, run] : runs) {
+        double mb_s = run.stream_ms > 0 ? (run.bytes / (1024.0 * 1024.0)) / (run.stream_ms / 1000.0) : 0.0;
+        std::cout << std::setw(8) << window << std::setw(10) << run.chunks << std::setw(14) << run.bytes
+                  << std::setw(10) << run.stream_ms << std::setw(10) << std::fixed << std::setprecision(2) << mb_s
+                  << (run.ok ? "" : "  (failed)") << std::endl;
+    }
     std::cout << "========================================\n" << std::endl;
 }
 
@@ -286,6 +531,10 @@ int main(int argc, char** argv){
     
     std::string mode = "session";
     std::string dataset_path = "";  // Dataset path for query field
+    mini2::Priority priority = mini2::PRIORITY_NORMAL;
+    int64_t deadline_ms = 0;        // relative to now, 0 = none
+    mini2::DeliveryMode delivery = mini2::DELIVERY_ORDERED;
+    uint32_t window = 8;            // FetchChunks: chunks the gateway may send ahead
     
     for (int i=1;i<argc;i++){
         std::string a = argv[i];
@@ -293,6 +542,33 @@ int main(int argc, char** argv){
         else if (a=="--mode" && i+1<argc) mode = argv[++i];
         else if (a=="--dataset" && i+1<argc) dataset_path = argv[++i];
         else if (a=="--query" && i+1<argc) dataset_path = argv[++i];  // Accept --query as alias
+        else if (a=="--deadline-ms" && i+1<argc) deadline_ms = std::stoll(argv[++i]);
+        else if (a=="--priority" && i+1<argc) {
+            std::string p = argv[++i];
+            if (p == "interactive") priority = mini2::PRIORITY_INTERACTIVE;
+            else if (p == "batch") priority = mini2::PRIORITY_BATCH;
+            else if (p == "normal") priority = mini2::PRIORITY_NORMAL;
+            else {
+                std::cerr << "Unknown priority: " << p << " (interactive, normal, batch)" << std::endl;
+                return 1;
+            }
+        }
+        else if (a=="--delivery" && i+1<argc) {
+            std::string d = argv[++i];
+            if (d == "ordered") delivery = mini2::DELIVERY_ORDERED;
+            else if (d == "unordered") delivery = mini2::DELIVERY_UNORDERED;
+            else {
+                std::cerr << "Unknown delivery mode: " << d << " (ordered, unordered)" << std::endl;
+                return 1;
+            }
+        }
+        else if (a=="--window" && i+1<argc) {
+            window = static_cast<uint32_t>(std::stoul(argv[++i]));
+            if (window == 0) {
+                std::cerr << "--window must be at least 1" << std::endl;
+                return 1;
+            }
+        }
     }
     
     std::cout << "=== Mini2 Client ===" << std::endl;
@@ -312,7 +588,7 @@ int main(int argc, char** argv){
         } else {
             std::cout << "PROCESSING DATASET: " << dataset_path << std::endl;
             std::cout << "Using Strategy B: GetNext (Sequential chunk retrieval)" << std::endl;
-            testStrategyB_GetNext(gateway, dataset_path);
+            testStrategyB_GetNext(gateway, dataset_path, priority, deadline_ms, delivery);
         }
     } else if (mode == "all") {
         // Test all 6 processes using config addresses
@@ -343,10 +619,14 @@ int main(int argc, char** argv){
         }
     } else if (mode == "strategy-b-getnext") {
         // Test Phase 3: Strategy B with GetNext
-        testStrategyB_GetNext(gateway, dataset_path);
+        testStrategyB_GetNext(gateway, dataset_path, priority, deadline_ms, delivery);
     } else if (mode == "strategy-b-pollnext") {
         // Test Phase 3: Strategy B with PollNext
-        testStrategyB_PollNext(gateway, dataset_path);
+        testStrategyB_PollNext(gateway, dataset_path, priority, deadline_ms, delivery);
+    } else if (mode == "strategy-b-stream") {
+        testStrategyB_Stream(gateway, dataset_path, priority, deadline_ms, delivery, window);
+    } else if (mode == "window-sweep") {
+        testWindowSweep(gateway, dataset_path, priority, deadline_ms, delivery);
     } else if (mode == "request") {
         // Single request mode - same as strategy-b-getnext for real data processing
         if (dataset_path.empty()) {
@@ -354,7 +634,7 @@ int main(int argc, char** argv){
             return 1;
         }
         std::cout << "PROCESSING DATASET: " << dataset_path << std::endl;
-        testStrategyB_GetNext(gateway, dataset_path);
+        testStrategyB_GetNext(gateway, dataset_path, priority, deadline_ms, delivery);
     } else if (mode == "phase3") {
         // Test Phase 3: Compare all strategies
         std::cout << "\n############################################" << std::endl;
@@ -375,7 +655,7 @@ int main(int argc, char** argv){
         std::cout << "############################################\n" << std::endl;
     } else {
         std::cout << "Unknown mode: " << mode << std::endl;
-        std::cout << "Available modes: ping, session, all, request, strategy-b-getnext, strategy-b-pollnext, phase3" << std::endl;
+        std::cout << "Available modes: ping, session, all, request, strategy-b-getnext, strategy-b-pollnext, strategy-b-stream, window-sweep, phase3" << std::endl;
         return 1;
     }
     
@@ -32,5 +32,87 @@ NetworkConfig LoadConfig(const std::string& path){
         for (auto &m : s["members"]) seg.members.push_back(m);
         out.segments.push_back(seg);
     }
+    if (j.contains("task_sizing")) {
+        const auto& ts = j["task_sizing"];
+        TaskSizingConfig& cfg = out.task_sizing;
+        cfg.policy               = ts.value("policy", cfg.policy);
+        cfg.target_task_bytes    = ts.value("target_task_bytes", cfg.target_task_bytes);
+        cfg.target_task_ms       = ts.value("target_task_ms", cfg.target_task_ms);
+        cfg.tasks_per_worker     = ts.value("tasks_per_worker", cfg.tasks_per_worker);
+        cfg.min_tasks_per_worker = ts.value("min_tasks_per_worker", cfg.min_tasks_per_worker);
+        cfg.min_task_rows        = ts.value("min_task_rows", cfg.min_task_rows);
+        cfg.max_tasks            = ts.value("max_tasks", cfg.max_tasks);
+        cfg.assignment           = ts.value("assignment", cfg.assignment);
+    }
+    if (j.contains("data_path")) {
+        const auto& dp = j["data_path"];
+        DataPathConfig& cfg = out.data_path;
+        cfg.direct_to_gateway = dp.value("direct_to_gateway", cfg.direct_to_gateway);
+        cfg.upload_frame_bytes = dp.value("upload_frame_bytes", cfg.upload_frame_bytes);
+    }
+    if (j.contains("speculation")) {
+        const auto& sp = j["speculation"];
+        SpeculationConfig& cfg = out.speculation;
+        cfg.enabled          = sp.value("enabled", cfg.enabled);
+        cfg.after_fraction   = sp.value("after_fraction", cfg.after_fraction);
+        cfg.straggler_factor = sp.value("straggler_factor", cfg.straggler_factor);
+        cfg.max_attempts     = sp.value("max_attempts", cfg.max_attempts);
+    }
+    if (j.contains("cross_team_steal")) {
+        const auto& cs = j["cross_team_steal"];
+        CrossTeamStealConfig& cfg = out.cross_team_steal;
+        cfg.enabled              = cs.value("enabled", cfg.enabled);
+        cfg.watermark_per_worker = cs.value("watermark_per_worker", cfg.watermark_per_worker);
+        cfg.max_batch            = cs.value("max_batch", cfg.max_batch);
+        cfg.interval_ms          = cs.value("interval_ms", cfg.interval_ms);
+    }
+    if (j.contains("gateway")) {
+        const auto& gw = j["gateway"];
+        GatewayConfig& cfg = out.gateway;
+        cfg.coalesce_requests    = gw.value("coalesce_requests", cfg.coalesce_requests);
+        cfg.max_running_requests = gw.value("max_running_requests", cfg.max_running_requests);
+        cfg.max_queued_requests  = gw.value("max_queued_requests", cfg.max_queued_requests);
+    }
+    if (j.contains("ingress")) {
+        const auto& ig = j["ingress"];
+        IngressConfig& cfg = out.ingress;
+        cfg.request_threads     = ig.value("request_threads", cfg.request_threads);
+        cfg.max_queued_requests = ig.value("max_queued_requests", cfg.max_queued_requests);
+    }
+    if (j.contains("sessions")) {
+        const auto& ss = j["sessions"];
+        SessionConfig& cfg = out.sessions;
+        cfg.sliding_window = ss.value("sliding_window", cfg.sliding_window);
+        cfg.reread_window  = ss.value("reread_window", cfg.reread_window);
+        cfg.shards         = ss.value("shards", cfg.shards);
+        cfg.resume_grace_s = ss.value("resume_grace_s", cfg.resume_grace_s);
+    }
+    if (j.contains("chunk_store")) {
+        const auto& cs = j["chunk_store"];
+        ChunkStoreConfig& cfg = out.chunk_store;
+        cfg.memory_budget_bytes = cs.value("memory_budget_bytes", cfg.memory_budget_bytes);
+        cfg.spill_dir           = cs.value("spill_dir", cfg.spill_dir);
+    }
+    if (j.contains("channel_pool")) {
+        const auto& cp = j["channel_pool"];
+        ChannelPoolConfig& cfg = out.channel_pool;
+        cfg.bulk_channels = cp.value("bulk_channels", cfg.bulk_channels);
+        cfg.warmup_ms     = cp.value("warmup_ms", cfg.warmup_ms);
+    }
+    if (j.contains("result_cache")) {
+        const auto& rc = j["result_cache"];
+        ResultCacheConfig& cfg = out.result_cache;
+        cfg.enabled     = rc.value("enabled", cfg.enabled);
+        cfg.max_bytes   = rc.value("max_bytes", cfg.max_bytes);
+        cfg.max_entries = rc.value("max_entries", cfg.max_entries);
+    }
+    if (j.contains("worker_executor")) {
+        const auto& we = j["worker_executor"];
+        WorkerExecutorConfig& cfg = out.worker_executor;
+        cfg.compute_threads = we.value("compute_threads", cfg.compute_threads);
+        cfg.prefetch        = we.value("prefetch", cfg.prefetch);
+        cfg.upload_threads  = we.value("upload_threads", cfg.upload_threads);
+        cfg.stream_tasks    = we.value("stream_tasks", cfg.stream_tasks);
+    }
     return out;
 }
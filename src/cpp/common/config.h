@@ -1,8 +1,8 @@
-
 #pragma once
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <cstdint>
 
 struct NodeInfo {
     std::string id;
@@ -22,11 +22,104 @@ struct SharedSegment {
     std::vector<std::string> members;
 };
 
+// How team leaders split a dataset into worker tasks ("task_sizing" in JSON)
+struct TaskSizingConfig {
+    std::string policy = "adaptive";          // "adaptive" or "fixed"
+    uint64_t target_task_bytes = 8ull << 20;  // payload size a single task should produce
+    uint32_t target_task_ms = 500;            // wall time a single task should take
+    uint32_t tasks_per_worker = 3;            // fixed policy: tasks = workers * this
+    uint32_t min_tasks_per_worker = 2;        // adaptive: keep every worker busy
+    uint64_t min_task_rows = 1000;            // adaptive: below this RPC overhead dominates
+    uint32_t max_tasks = 512;                 // adaptive: hard cap per request
+    std::string assignment = "cost_model";    // "cost_model" (throughput-proportional shares) or "greedy"
+};
+
+// How result payloads travel back to the gateway ("data_path" in JSON)
+struct DataPathConfig {
+    bool direct_to_gateway = false;  // workers push payloads to A, team leaders only get notices
+    uint64_t upload_frame_bytes = 4ull << 20;  // results larger than this are streamed in frames (0 = never)
+};
+
+// Backup copies of straggling tasks on team leaders ("speculation" in JSON)
+struct SpeculationConfig {
+    bool enabled = true;
+    double after_fraction = 0.75;   // speculate once this share of a request's tasks is done
+    double straggler_factor = 2.0;  // ...or a task has run this many times the holder's avg_task_ms
+    uint32_t max_attempts = 2;      // original + backups per task
+};
+
+// Team leaders pulling surplus tasks from each other ("cross_team_steal" in JSON)
+struct CrossTeamStealConfig {
+    bool enabled = true;
+    uint32_t watermark_per_worker = 2;  // victim keeps this many queued tasks per healthy worker
+    uint32_t max_batch = 4;             // tasks handed over per steal
+    uint32_t interval_ms = 200;         // idle check period (doubles up to 10x while peers have nothing)
+};
+
+// Client-facing behavior of the gateway (A) ("gateway" in JSON)
+struct GatewayConfig {
+    bool coalesce_requests = true;     // identical concurrent requests share one execution
+    uint32_t max_running_requests = 4; // requests executing across the cluster at once
+    uint32_t max_queued_requests = 32; // waiting beyond that; further requests are REJECTED
+};
+
+// Finished results kept at the gateway ("result_cache" in JSON)
+struct ResultCacheConfig {
+    bool enabled = true;
+    uint64_t max_bytes = 1ull << 30;  // payload bytes across all entries
+    uint32_t max_entries = 64;        // 0 = bytes budget only
+};
+
+// Worker-side task pipeline on C, D, F ("worker_executor" in JSON)
+struct WorkerExecutorConfig {
+    uint32_t compute_threads = 0;  // 0 = capacity_score, capped by core count
+    uint32_t prefetch = 0;         // tasks pulled ahead / stream credit window (0 = compute_threads)
+    uint32_t upload_threads = 1;   // parallel result uploads
+    bool stream_tasks = true;      // team leader pushes tasks over StreamTasks (false = RequestTask polling)
+};
+
+// Data-plane handlers of TeamIngress on B, E and workers ("ingress" in JSON)
+struct IngressConfig {
+    uint32_t request_threads = 4;       // HandleRequest calls running at once (each may wait ~10s)
+    uint32_t max_queued_requests = 64;  // waiting for a thread; beyond that RESOURCE_EXHAUSTED
+};
+
+// Connections to each peer ("channel_pool" in JSON): one for control RPCs plus bulk ones for result payloads
+struct ChannelPoolConfig {
+    uint32_t bulk_channels = 2;   // result payload connections, round-robin (0 = share the control connection)
+    uint32_t warmup_ms = 2000;    // startup wait for every connection to become READY (logged, not fatal)
+};
+
+// Chunk retention of gateway sessions ("sessions" in JSON)
+struct SessionConfig {
+    bool sliding_window = true;     // release chunks once the client's GetNext cursor has moved past them
+    uint32_t reread_window = 2;     // chunks kept behind the cursor so a retried GetNext still succeeds
+    uint32_t shards = 32;           // session table shards, each with its own lock
+    uint32_t resume_grace_s = 300;  // an idle session is kept this long so a client can resume it
+};
+
+// Session chunks held by the gateway (A) ("chunk_store" in JSON)
+struct ChunkStoreConfig {
+    uint64_t memory_budget_bytes = 4294967296ULL;  // payload bytes kept in memory across sessions (0 = no limit)
+    std::string spill_dir = "/tmp/mini2-spill";    // chunks beyond the budget are written here
+};
+
 struct NetworkConfig {
     std::unordered_map<std::string, NodeInfo> nodes;
     Overlay overlay;
     std::string client_gateway;
     std::vector<SharedSegment> segments;
+    TaskSizingConfig task_sizing;
+    DataPathConfig data_path;
+    SpeculationConfig speculation;
+    WorkerExecutorConfig worker_executor;
+    CrossTeamStealConfig cross_team_steal;
+    ResultCacheConfig result_cache;
+    GatewayConfig gateway;
+    IngressConfig ingress;
+    ChannelPoolConfig channel_pool;
+    ChunkStoreConfig chunk_store;
+    SessionConfig sessions;
 };
 
 NetworkConfig LoadConfig(const std::string& path);
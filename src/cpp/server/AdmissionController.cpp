@@ -0,0 +1,108 @@
+// AdmissionController.cpp - Bounded concurrency and queueing for gateway requests
+
+#include "AdmissionController.h"
+#include "../common/logging.h"
+#include <algorithm>
+
+namespace {
+// Assumed execution time before any request has finished
+constexpr double kDefaultRunMs = 2000.0;
+constexpr double kRunMsAlpha = 0.2;
+}
+
+AdmissionController::AdmissionController(const std::string& node_id, uint32_t max_running,
+                                         uint32_t max_queued, Launcher launch)
+    : node_id_(node_id)
+    , max_running_(std::max<uint32_t>(1, max_running))
+    , max_queued_(max_queued)
+    , launch_(std::move(launch)) {}
+
+AdmissionController::Decision AdmissionController::Submit(const std::string& session_id, Job job,
+                                                              ScheduleKey key) {
+    Decision decision;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_ < max_running_ && queue_.empty()) {
+            running_++;
+            admitted_++;
+            decision.outcome = Outcome::RUNNING;
+        } else if (queue_.size() < max_queued_) {
+            InsertOrdered(queue_, Waiting{session_id, key, std::move(job)},
+                          [](const Waiting& w) { return w.key; });
+            admitted_++;
+            decision.outcome = Outcome::QUEUED;
+            for (size_t i = 0; i < queue_.size(); ++i) {
+                if (queue_[i].session_id == session_id) decision.queue_position = static_cast<uint32_t>(i + 1);
+            }
+            decision.eta_ms = EtaForPosition(decision.queue_position);
+        } else {
+            rejected_++;
+            decision.outcome = Outcome::REJECTED;
+            decision.eta_ms = EtaForPosition(static_cast<uint32_t>(queue_.size()) + 1);
+        }
+    }
+    
+    if (decision.outcome == Outcome::RUNNING) {
+        Start(std::move(job));
+    } else if (decision.outcome == Outcome::QUEUED) {
+        LOG_INFO(node_id_, "Admission", 
+                 "Queued " + session_id + " at position " + std::to_string(decision.queue_position) +
+                 " (eta " + std::to_string(decision.eta_ms) + "ms)");
+    } else {
+        LOG_WARN(node_id_, "Admission", 
+                 "Rejected " + session_id + ": " + std::to_string(max_running_) + " running, " +
+                 std::to_string(max_queued_) + " queued");
+    }
+    return decision;
+}
+
+void AdmissionController::Start(Job job) {
+    launch_([this, job = std::move(job)]() {
+        auto start = std::chrono::steady_clock::now();
+        job();
+        OnFinished(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    });
+}
+
+void AdmissionController::OnFinished(double run_ms) {
+    Job next;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        avg_run_ms_ = avg_run_ms_ > 0.0 ? (1.0 - kRunMsAlpha) * avg_run_ms_ + kRunMsAlpha * run_ms : run_ms;
+        if (queue_.empty()) {
+            running_--;
+            return;
+        }
+        // The slot passes straight to the head of the queue
+        next = std::move(queue_.front().job);
+        LOG_DEBUG(node_id_, "Admission", "Starting queued " + queue_.front().session_id);
+        queue_.pop_front();
+    }
+    Start(std::move(next));
+}
+
+uint64_t AdmissionController::EtaForPosition(uint32_t position) const {
+    // Called with mutex_ held. Requests start in waves of max_running_
+    const double run_ms = avg_run_ms_ > 0.0 ? avg_run_ms_ : kDefaultRunMs;
+    const uint32_t waves = (position + max_running_ - 1) / max_running_;
+    return static_cast<uint64_t>(waves * run_ms);
+}
+
+uint32_t AdmissionController::PositionOf(const std::string& session_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        if (queue_[i].session_id == session_id) return static_cast<uint32_t>(i + 1);
+    }
+    return 0;
+}
+
+AdmissionController::Stats AdmissionController::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.running = running_;
+    s.queued = static_cast<uint32_t>(queue_.size());
+    s.admitted = admitted_;
+    s.rejected = rejected_;
+    s.avg_run_ms = avg_run_ms_;
+    return s;
+}
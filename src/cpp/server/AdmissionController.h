@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Priority.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Gateway admission control (A): at most max_running requests execute at once,
+// up to max_queued wait ordered by priority and deadline (FIFO among equals),
+// anything beyond that is rejected right away.
+class AdmissionController {
+public:
+    using Job = std::function<void()>;
+    using Launcher = std::function<void(Job)>;  // runs a job asynchronously
+
+    enum class Outcome { RUNNING, QUEUED, REJECTED };
+    struct Decision {
+        Outcome  outcome = Outcome::RUNNING;
+        uint32_t queue_position = 0;  // 1-based while QUEUED
+        uint64_t eta_ms = 0;          // estimated wait before it starts (REJECTED: retry hint)
+    };
+
+    struct Stats {
+        uint32_t running = 0;
+        uint32_t queued = 0;
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+        double   avg_run_ms = 0.0;
+    };
+
+    AdmissionController(const std::string& node_id, uint32_t max_running, uint32_t max_queued,
+                        Launcher launch);
+
+    Decision Submit(const std::string& session_id, Job job, ScheduleKey key = ScheduleKey());
+
+    // Current 1-based queue position, 0 once running or unknown
+    uint32_t PositionOf(const std::string& session_id) const;
+    Stats GetStats() const;
+
+private:
+    void Start(Job job);
+    void OnFinished(double run_ms);
+    uint64_t EtaForPosition(uint32_t position) const;  // called with mutex_ held
+
+    std::string node_id_;
+    uint32_t max_running_;
+    uint32_t max_queued_;
+    Launcher launch_;
+
+    mutable std::mutex mutex_;
+    struct Waiting {
+        std::string session_id;
+        ScheduleKey key;
+        Job job;
+    };
+    std::deque<Waiting> queue_;
+    uint32_t running_ = 0;
+    uint64_t admitted_ = 0;
+    uint64_t rejected_ = 0;
+    double avg_run_ms_ = 0.0;  // EMA of execution time (0 = no history)
+};
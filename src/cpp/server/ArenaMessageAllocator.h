@@ -0,0 +1,98 @@
+#pragma once
+
+#include <google/protobuf/arena.h>
+#include <grpcpp/support/message_allocator.h>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Protobuf arena whose first block lives inside this object: messages that fit in it
+// cost no malloc at all, anything larger spills into blocks the arena allocates
+template <size_t kInlineBytes>
+class InlineArena {
+public:
+    InlineArena() : arena_(Options(block_)) {}
+    InlineArena(const InlineArena&) = delete;
+    InlineArena& operator=(const InlineArena&) = delete;
+
+    google::protobuf::Arena* get() { return &arena_; }
+    void Reset() { arena_.Reset(); }  // keeps the inline block
+
+private:
+    static google::protobuf::ArenaOptions Options(char* block) {
+        google::protobuf::ArenaOptions options;
+        options.initial_block = block;
+        options.initial_block_size = kInlineBytes;
+        return options;
+    }
+
+    alignas(alignof(std::max_align_t)) char block_[kInlineBytes];
+    google::protobuf::Arena arena_;  // after block_: constructed on top of it
+};
+
+// Request/response allocator for unary callback methods: both messages and all of
+// their sub-objects live on one protobuf arena per call, starting in a block inline
+// in the holder, and the whole call is freed with a single Arena::Reset(). Holders
+// are recycled, so a call with small messages does not touch malloc for them at all.
+// Register with SetMessageAllocatorFor_<Method>(); must outlive the server.
+template <typename Req, typename Resp, size_t kInlineBytes = 4096>
+class ArenaMessageAllocator : public grpc::MessageAllocator<Req, Resp> {
+public:
+    explicit ArenaMessageAllocator(size_t max_cached = 64) : max_cached_(max_cached) {
+        free_.reserve(max_cached_);
+    }
+
+    ~ArenaMessageAllocator() override {
+        for (Holder* holder : free_) delete holder;
+    }
+
+    grpc::MessageHolder<Req, Resp>* AllocateMessages() override {
+        Holder* holder = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                holder = free_.back();
+                free_.pop_back();
+            }
+        }
+        if (!holder) holder = new Holder(this);
+        holder->CreateMessages();
+        return holder;
+    }
+
+private:
+    class Holder : public grpc::MessageHolder<Req, Resp> {
+    public:
+        explicit Holder(ArenaMessageAllocator* owner) : owner_(owner) {}
+
+        void CreateMessages() {
+            this->set_request(google::protobuf::Arena::CreateMessage<Req>(arena_.get()));
+            this->set_response(google::protobuf::Arena::CreateMessage<Resp>(arena_.get()));
+        }
+
+        // Called by gRPC once the call is done (after the reactor's OnDone)
+        void Release() override {
+            arena_.Reset();  // frees whatever a large message added beyond the inline block
+            owner_->Recycle(this);
+        }
+
+    private:
+        ArenaMessageAllocator* owner_;
+        InlineArena<kInlineBytes> arena_;
+    };
+
+    void Recycle(Holder* holder) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_.size() < max_cached_) {
+                free_.push_back(holder);
+                return;
+            }
+        }
+        delete holder;
+    }
+
+    size_t max_cached_;
+    std::mutex mutex_;
+    std::vector<Holder*> free_;
+};
@@ -0,0 +1,122 @@
+// BoundedExecutor.cpp - Fixed thread pool with a bounded queue and graceful drain
+
+#include "BoundedExecutor.h"
+#include "../common/logging.h"
+#include <algorithm>
+
+namespace {
+constexpr double kWaitMsAlpha = 0.2;
+}
+
+BoundedExecutor::BoundedExecutor(const std::string& name, size_t threads, size_t max_queue)
+    : name_(name)
+    , max_queue_(max_queue) {
+    threads = std::max<size_t>(1, threads);
+    stats_.threads = threads;
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+BoundedExecutor::~BoundedExecutor() {
+    Shutdown();
+}
+
+bool BoundedExecutor::TrySubmit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!accepting_ || queue_.size() >= max_queue_) {
+            stats_.rejected++;
+            return false;
+        }
+        queue_.push_back(Queued{std::move(job), std::chrono::steady_clock::now()});
+        stats_.submitted++;
+        stats_.queued = queue_.size();
+        stats_.max_queued = std::max(stats_.max_queued, stats_.queued);
+    }
+    work_cv_.notify_one();
+    return true;
+}
+
+void BoundedExecutor::WorkerLoop() {
+    while (true) {
+        Queued item;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;  // stopping and nothing left
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            stats_.queued = queue_.size();
+            stats_.active++;
+            double wait_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - item.enqueued).count();
+            stats_.avg_wait_ms = stats_.completed > 0
+                ? (1.0 - kWaitMsAlpha) * stats_.avg_wait_ms + kWaitMsAlpha * wait_ms
+                : wait_ms;
+        }
+
+        try {
+            item.job();
+        } catch (const std::exception& e) {
+            LOG_ERROR(name_, "Executor", std::string("Job threw: ") + e.what());
+        } catch (...) {
+            LOG_ERROR(name_, "Executor", "Job threw an unknown exception");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.active--;
+            stats_.completed++;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+bool BoundedExecutor::WaitIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto idle = [this]() { return queue_.empty() && stats_.active == 0; };
+    if (timeout == std::chrono::milliseconds::max()) {
+        idle_cv_.wait(lock, idle);
+        return true;
+    }
+    return idle_cv_.wait_for(lock, timeout, idle);
+}
+
+bool BoundedExecutor::Shutdown(std::chrono::milliseconds timeout) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (threads_.empty()) return queue_.empty();
+        accepting_ = false;
+    }
+
+    bool drained = WaitIdle(timeout);
+    size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropped = queue_.size();
+        queue_.clear();
+        stats_.queued = 0;
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+
+    // Running jobs cannot be interrupted; joining waits for them
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+
+    if (dropped > 0) {
+        LOG_WARN(name_, "Executor",
+                 "Shutdown dropped " + std::to_string(dropped) + " queued job(s) after drain timeout");
+    } else {
+        LOG_INFO(name_, "Executor", "Drained and stopped");
+    }
+    return drained;
+}
+
+BoundedExecutor::Stats BoundedExecutor::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
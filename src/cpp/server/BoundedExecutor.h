@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed pool of threads over a bounded FIFO queue. Thread count and memory stay
+// flat however bursty the submissions are; Shutdown() drains before joining.
+class BoundedExecutor {
+public:
+    using Job = std::function<void()>;
+
+    struct Stats {
+        size_t   threads = 0;
+        size_t   active = 0;          // jobs running right now
+        size_t   queued = 0;          // jobs waiting for a thread
+        size_t   max_queued = 0;      // high-water mark of `queued`
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t rejected = 0;        // queue full or shut down
+        double   avg_wait_ms = 0.0;   // EMA of time spent queued
+    };
+
+    BoundedExecutor(const std::string& name, size_t threads, size_t max_queue);
+    ~BoundedExecutor();  // Shutdown() without a deadline
+
+    // False (job dropped) when the queue is full or the executor is shutting down
+    bool TrySubmit(Job job);
+
+    // Waits until nothing is queued or running, up to `timeout`; keeps accepting work
+    bool WaitIdle(std::chrono::milliseconds timeout);
+
+    // Stops accepting work, lets queued and running jobs finish (up to `timeout`,
+    // after which queued jobs are dropped) and joins the threads. True if fully drained.
+    bool Shutdown(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+    Stats GetStats() const;
+
+private:
+    struct Queued {
+        Job job;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+    void WorkerLoop();
+
+    std::string name_;
+    size_t max_queue_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;  // job queued / stopping
+    std::condition_variable idle_cv_;  // job finished
+    std::deque<Queued> queue_;
+    std::vector<std::thread> threads_;
+    bool accepting_ = true;
+    bool stopping_ = false;
+    Stats stats_;
+};
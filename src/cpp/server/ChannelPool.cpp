@@ -0,0 +1,91 @@
+// ChannelPool.cpp - Per-peer control and bulk connections
+
+#include "ChannelPool.h"
+#include "../common/logging.h"
+
+ChannelPool::ChannelPool(const std::string& node_id, const grpc::ChannelArguments& base_args)
+    : node_id_(node_id)
+    , base_args_(base_args) {}
+
+void ChannelPool::Configure(const ChannelPoolConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+ChannelPool::Lane ChannelPool::OpenLane(const std::string& addr, const std::string& name) const {
+    grpc::ChannelArguments args = base_args_;
+    // Channels with identical args share one connection through the global subchannel
+    // pool; a local pool plus a per-lane tag gives every lane its own connection
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    args.SetString("mini2.lane", name);
+
+    Lane lane;
+    lane.channel = grpc::CreateCustomChannel(addr, grpc::InsecureChannelCredentials(), args);
+    lane.channel->GetState(true);  // start connecting now rather than on the first RPC
+    lane.stub = mini2::TeamIngress::NewStub(lane.channel);
+    return lane;
+}
+
+ChannelPool::Peer& ChannelPool::PeerFor(const std::string& addr) {
+    auto it = peers_.find(addr);
+    if (it != peers_.end()) return it->second;
+
+    Peer& peer = peers_[addr];
+    peer.control = OpenLane(addr, "control");
+    for (uint32_t i = 0; i < config_.bulk_channels; ++i) {
+        peer.bulk.push_back(OpenLane(addr, "bulk-" + std::to_string(i)));
+    }
+    LOG_INFO(node_id_, "ChannelPool",
+             "Opened " + addr + ": 1 control + " + std::to_string(peer.bulk.size()) + " bulk channel(s)");
+    return peer;
+}
+
+void ChannelPool::Register(const std::string& addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PeerFor(addr);
+}
+
+std::shared_ptr<grpc::Channel> ChannelPool::ControlChannel(const std::string& addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return PeerFor(addr).control.channel;
+}
+
+mini2::TeamIngress::Stub* ChannelPool::Control(const std::string& addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return PeerFor(addr).control.stub.get();
+}
+
+mini2::TeamIngress::Stub* ChannelPool::Bulk(const std::string& addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Peer& peer = PeerFor(addr);
+    if (peer.bulk.empty()) return peer.control.stub.get();
+    Lane& lane = peer.bulk[peer.next_bulk++ % peer.bulk.size()];
+    return lane.stub.get();
+}
+
+bool ChannelPool::WarmUp(std::chrono::milliseconds timeout) {
+    std::vector<std::pair<std::string, std::vector<std::shared_ptr<grpc::Channel>>>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [addr, peer] : peers_) {
+            std::vector<std::shared_ptr<grpc::Channel>> channels{peer.control.channel};
+            for (const auto& lane : peer.bulk) channels.push_back(lane.channel);
+            snapshot.emplace_back(addr, std::move(channels));
+        }
+    }
+
+    // One shared deadline: peers that are still starting up must not stall this node
+    auto deadline = std::chrono::system_clock::now() + timeout;
+    bool all_ready = true;
+    for (const auto& [addr, channels] : snapshot) {
+        size_t ready = 0;
+        for (const auto& channel : channels) {
+            if (channel->WaitForConnected(deadline)) ready++;
+        }
+        all_ready = all_ready && ready == channels.size();
+        LOG_INFO(node_id_, "ChannelPool",
+                 "Warm-up " + addr + ": " + std::to_string(ready) + "/" +
+                 std::to_string(channels.size()) + " channel(s) READY");
+    }
+    return all_ready;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include "minitwo.grpc.pb.h"
+#include "../common/config.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Connections to each peer, split by traffic class. Control RPCs (requests,
+// heartbeats, task dispatch, completion notices) get a connection of their own so
+// they never queue behind a result payload of hundreds of MB on the same HTTP/2
+// connection; payloads round-robin over `bulk_channels` further connections.
+class ChannelPool {
+public:
+    ChannelPool(const std::string& node_id, const grpc::ChannelArguments& base_args);
+
+    void Configure(const ChannelPoolConfig& config);  // before the first Register
+
+    // Opens every lane to `addr` and starts connecting them; no-op if already known
+    void Register(const std::string& addr);
+
+    // Register on first use
+    std::shared_ptr<grpc::Channel> ControlChannel(const std::string& addr);
+    mini2::TeamIngress::Stub* Control(const std::string& addr);
+    mini2::TeamIngress::Stub* Bulk(const std::string& addr);
+
+    // Waits up to `timeout` for all lanes to be READY and logs the outcome per peer
+    bool WarmUp(std::chrono::milliseconds timeout);
+
+private:
+    struct Lane {
+        std::shared_ptr<grpc::Channel> channel;
+        std::unique_ptr<mini2::TeamIngress::Stub> stub;
+    };
+    struct Peer {
+        Lane control;
+        std::vector<Lane> bulk;  // empty = payloads share the control lane
+        size_t next_bulk = 0;
+    };
+
+    Lane OpenLane(const std::string& addr, const std::string& name) const;
+    Peer& PeerFor(const std::string& addr);  // called with mutex_ held
+
+    std::string node_id_;
+    grpc::ChannelArguments base_args_;
+    ChannelPoolConfig config_;
+
+    std::mutex mutex_;
+    std::map<std::string, Peer> peers_;  // addr -> lanes; never erased, stubs stay valid
+};
@@ -0,0 +1,276 @@
+// ChunkStore.cpp - Session chunk payloads under a memory budget, spilled to disk beyond it
+
+#include "ChunkStore.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+constexpr double kLatencyAlpha = 0.2;
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+struct ChunkStore::Entry::SpillFile {
+    int fd = -1;
+    std::mutex mutex;   // guards size (appends)
+    uint64_t size = 0;
+    ~SpillFile() {
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+ChunkStore::ChunkStore(const ChunkStoreConfig& config) : config_(config) {
+    std::cout << "[ChunkStore] memory budget=" << config_.memory_budget_bytes
+              << " bytes, spill_dir=" << config_.spill_dir << std::endl;
+}
+
+ChunkStore::~ChunkStore() = default;
+
+ChunkStore::Entry::~Entry() {
+    if (!store_) return;
+    if (memory_) {
+        store_->memory_bytes_ -= size_;
+        store_->memory_chunks_--;
+    } else if (file_) {
+        store_->spilled_bytes_ -= size_;
+        store_->spilled_chunks_--;
+    }
+}
+
+bool ChunkStore::Entry::spilled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ != nullptr;
+}
+
+ChunkStore::Ref ChunkStore::Put(const std::string& session_id, Chunk chunk) {
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        auto& slot = buffers_[chunk.get()];
+        if (auto existing = slot.lock()) return existing;  // another session's buffer: counted already
+
+        entry = std::make_shared<Entry>();
+        entry->session_id_ = session_id;
+        entry->seq_ = next_seq_++;
+        entry->part_index_ = chunk->part_index();
+        entry->frame_index_ = chunk->frame_index();
+        entry->size_ = chunk->payload().size();
+        entry->memory_ = std::move(chunk);
+        entry->store_ = this;  // from here on the destructor gives the bytes back
+        memory_bytes_ += entry->size_;
+        memory_chunks_++;
+        slot = entry;
+    }
+
+    // Spilling only pays if nobody else keeps the buffer alive; otherwise Trim
+    // picks it up once they let go
+    const uint64_t budget = config_.memory_budget_bytes;
+    if (budget != 0 && memory_bytes_ > budget) {
+        std::lock_guard<std::mutex> lock(entry->mutex_);
+        if (entry->memory_.use_count() == 1) Spill(*entry);
+    }
+    return entry;
+}
+
+void ChunkStore::Trim() {
+    const uint64_t budget = config_.memory_budget_bytes;
+    if (budget == 0 || memory_bytes_ <= budget) return;
+
+    std::vector<std::shared_ptr<Entry>> entries;  // declared first: let go outside the lock
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        entries.reserve(buffers_.size());
+        for (auto it = buffers_.begin(); it != buffers_.end(); ) {
+            if (auto entry = it->second.lock()) {
+                entries.push_back(std::move(entry));
+                ++it;
+            } else {
+                it = buffers_.erase(it);
+            }
+        }
+    }
+
+    // Newest first: clients read in order, so those are needed last
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a->seq_ > b->seq_; });
+    size_t spilled = 0;
+    size_t shared = 0;
+    for (auto& entry : entries) {
+        if (memory_bytes_ <= budget) break;
+        std::lock_guard<std::mutex> lock(entry->mutex_);
+        if (!entry->memory_) continue;
+        if (entry->memory_.use_count() != 1) {
+            shared++;
+            continue;
+        }
+        if (Spill(*entry)) spilled++;
+    }
+    if (spilled == 0) return;
+    std::cout << "[ChunkStore] trim spilled " << spilled << " chunks, in memory="
+              << memory_bytes_.load() << "/" << budget << " (" << shared
+              << " held elsewhere)" << std::endl;
+}
+
+void ChunkStore::Forget(const Entry& entry) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    auto it = buffers_.find(entry.memory_.get());
+    if (it != buffers_.end() && it->second.lock().get() == &entry) {
+        buffers_.erase(it);  // the address may be reused by another buffer
+    }
+}
+
+std::shared_ptr<ChunkStore::Entry::SpillFile> ChunkStore::SpillFileFor(const std::string& session_id) {
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    auto it = files_.find(session_id);
+    if (it != files_.end()) {
+        if (auto file = it->second.lock()) return file;
+    }
+
+    // Forget files whose sessions are gone
+    for (auto f = files_.begin(); f != files_.end(); ) {
+        f = f->second.expired() ? files_.erase(f) : std::next(f);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(config_.spill_dir, ec);
+    const std::string path = config_.spill_dir + "/" + session_id + "-" +
+                             std::to_string(::getpid()) + ".spill";
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        std::cerr << "[ChunkStore] cannot open spill file " << path << ": "
+                  << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    ::unlink(path.c_str());  // lives on through fd only
+
+    auto file = std::make_shared<Entry::SpillFile>();
+    file->fd = fd;
+    files_[session_id] = file;
+    return file;
+}
+
+bool ChunkStore::Spill(Entry& entry) {
+    auto start = std::chrono::steady_clock::now();
+    auto file = SpillFileFor(entry.session_id_);
+    if (!file) {
+        spill_errors_++;
+        return false;  // no disk to spare: going over budget beats losing the chunk
+    }
+
+    const std::string& payload = entry.memory_->payload();
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(file->mutex);
+        offset = file->size;
+        size_t written = 0;
+        while (written < payload.size()) {
+            ssize_t n = ::pwrite(file->fd, payload.data() + written, payload.size() - written,
+                                 static_cast<off_t>(offset + written));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "[ChunkStore] spill write failed for " << entry.session_id_ << ": "
+                          << std::strerror(errno) << std::endl;
+                spill_errors_++;
+                return false;  // size not advanced: the next spill overwrites the partial write
+            }
+            written += static_cast<size_t>(n);
+        }
+        file->size += payload.size();
+    }
+
+    Forget(entry);
+    entry.memory_.reset();
+    entry.file_ = std::move(file);
+    entry.offset_ = offset;
+    memory_bytes_ -= entry.size_;
+    memory_chunks_--;
+    spilled_chunks_++;
+    spilled_bytes_ += entry.size_;
+    spill_bytes_total_ += entry.size_;
+    spill_writes_++;
+
+    double ms = MsSince(start);
+    RecordLatency(avg_spill_write_ms_, ms);
+    std::cout << "[ChunkStore] spill chunk " << entry.part_index_ << " of " << entry.session_id_
+              << " (" << entry.size_ << " bytes, " << ms << " ms, in memory="
+              << memory_bytes_.load() << "/" << config_.memory_budget_bytes << ")" << std::endl;
+    return true;
+}
+
+bool ChunkStore::Read(const Entry& entry, std::string* out, uint64_t offset) {
+    Chunk memory;
+    std::shared_ptr<Entry::SpillFile> file;
+    uint64_t file_offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex_);
+        memory = entry.memory_;
+        file = entry.file_;
+        file_offset = entry.offset_;
+    }
+
+    offset = std::min(offset, entry.size_);
+    const uint64_t wanted = entry.size_ - offset;
+    if (!file) {
+        out->assign(memory->payload(), static_cast<size_t>(offset), static_cast<size_t>(wanted));
+        return true;
+    }
+    if (wanted == 0) {
+        out->clear();
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    static const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const uint64_t begin = file_offset + offset;
+    const uint64_t aligned = begin - begin % page;
+    const size_t delta = static_cast<size_t>(begin - aligned);
+    const size_t length = delta + static_cast<size_t>(wanted);
+
+    void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file->fd, static_cast<off_t>(aligned));
+    if (map == MAP_FAILED) {
+        std::cerr << "[ChunkStore] cannot map spilled chunk " << entry.part_index_ << ": "
+                  << std::strerror(errno) << std::endl;
+        spill_errors_++;
+        return false;
+    }
+    ::madvise(map, length, MADV_SEQUENTIAL);
+    out->assign(static_cast<const char*>(map) + delta, static_cast<size_t>(wanted));
+    ::munmap(map, length);
+
+    spill_reads_++;
+    RecordLatency(avg_spill_read_ms_, MsSince(start));
+    return true;
+}
+
+void ChunkStore::RecordLatency(std::atomic<double>& avg, double ms) {
+    double current = avg.load();
+    double next;
+    do {
+        next = current > 0.0 ? (1.0 - kLatencyAlpha) * current + kLatencyAlpha * ms : ms;
+    } while (!avg.compare_exchange_weak(current, next));
+}
+
+ChunkStore::Stats ChunkStore::GetStats() const {
+    Stats stats;
+    stats.budget_bytes = config_.memory_budget_bytes;
+    stats.memory_bytes = memory_bytes_;
+    stats.memory_chunks = memory_chunks_;
+    stats.spilled_chunks = spilled_chunks_;
+    stats.spilled_bytes = spilled_bytes_;
+    stats.spill_bytes_total = spill_bytes_total_;
+    stats.spill_writes = spill_writes_;
+    stats.spill_reads = spill_reads_;
+    stats.spill_errors = spill_errors_;
+    stats.avg_spill_write_ms = avg_spill_write_ms_;
+    stats.avg_spill_read_ms = avg_spill_read_ms_;
+    return stats;
+}
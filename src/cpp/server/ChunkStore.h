@@ -0,0 +1,111 @@
+#pragma once
+
+#include "minitwo.pb.h"
+#include "../common/config.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Payloads of session chunks under a node-wide memory budget. The budget counts
+// distinct result buffers: sessions sharing one (coalesced requests, cache hits)
+// share its entry. Past the budget, buffers the store alone holds are written to
+// their session's spill file and mapped back in when a client fetches them; a
+// buffer someone else still holds (the request still running, the result cache)
+// stays in memory, since spilling it would free nothing. Memory and disk are given
+// back as soon as the last reference to a chunk goes away.
+class ChunkStore {
+public:
+    using Chunk = std::shared_ptr<const mini2::WorkerResult>;
+
+    class Entry;
+    using Ref = std::shared_ptr<const Entry>;
+
+    struct Stats {
+        uint64_t budget_bytes = 0;
+        uint64_t memory_bytes = 0;      // payload bytes held in memory right now
+        uint64_t memory_chunks = 0;
+        uint64_t spilled_chunks = 0;    // on disk right now
+        uint64_t spilled_bytes = 0;
+        uint64_t spill_bytes_total = 0; // ever written
+        uint64_t spill_writes = 0;
+        uint64_t spill_reads = 0;
+        uint64_t spill_errors = 0;      // failed writes (kept in memory) or reads
+        double   avg_spill_write_ms = 0.0;  // EMA
+        double   avg_spill_read_ms = 0.0;   // EMA
+    };
+
+    explicit ChunkStore(const ChunkStoreConfig& config = ChunkStoreConfig());
+    ~ChunkStore();  // all entries must be gone by then
+
+    // Returns the entry for `chunk`'s buffer, creating it if no session holds it yet.
+    // A new entry past the budget is spilled if the store is its only holder.
+    Ref Put(const std::string& session_id, Chunk chunk);
+
+    // Spills in-memory buffers the store alone holds, newest first, until memory is
+    // back under the budget. Run once the other holders let go of their results.
+    void Trim();
+
+    // Copies the payload from byte `offset` on into `out`, mapping it from disk if
+    // spilled; false on I/O error. An offset past the end yields an empty string.
+    bool Read(const Entry& entry, std::string* out, uint64_t offset = 0);
+
+    Stats GetStats() const;
+
+    class Entry {
+    public:
+        ~Entry();
+        uint32_t part_index() const { return part_index_; }
+        uint32_t frame_index() const { return frame_index_; }
+        uint64_t size() const { return size_; }
+        bool spilled() const;
+
+    private:
+        friend class ChunkStore;
+        struct SpillFile;
+
+        ChunkStore* store_ = nullptr;
+        std::string session_id_;  // whose spill file takes it
+        uint64_t seq_ = 0;        // Put order, for Trim
+        uint32_t part_index_ = 0;
+        uint32_t frame_index_ = 0;
+        uint64_t size_ = 0;
+        mutable std::mutex mutex_;          // guards the fields below; Trim may spill later
+        Chunk memory_;                      // in memory
+        std::shared_ptr<SpillFile> file_;   // spilled: byte range [offset_, offset_ + size_)
+        uint64_t offset_ = 0;
+    };
+
+private:
+    std::shared_ptr<Entry::SpillFile> SpillFileFor(const std::string& session_id);
+    bool Spill(Entry& entry);  // entry.mutex_ held
+    void Forget(const Entry& entry);
+    void RecordLatency(std::atomic<double>& avg, double ms);
+
+    ChunkStoreConfig config_;
+    std::atomic<uint64_t> memory_bytes_{0};
+    std::atomic<uint64_t> memory_chunks_{0};
+    std::atomic<uint64_t> spilled_chunks_{0};
+    std::atomic<uint64_t> spilled_bytes_{0};
+    std::atomic<uint64_t> spill_bytes_total_{0};
+    std::atomic<uint64_t> spill_writes_{0};
+    std::atomic<uint64_t> spill_reads_{0};
+    std::atomic<uint64_t> spill_errors_{0};
+    std::atomic<double> avg_spill_write_ms_{0.0};
+    std::atomic<double> avg_spill_read_ms_{0.0};
+    std::atomic<uint64_t> next_seq_{0};
+
+    // In-memory entries by the buffer they hold, so every session holding a buffer
+    // gets the same entry and its bytes count once. Spilled entries drop out.
+    std::mutex buffers_mutex_;
+    std::unordered_map<const mini2::WorkerResult*, std::weak_ptr<Entry>> buffers_;
+
+    // One append-only file per session, shared by its spilled entries; the file is
+    // unlinked as soon as it is opened, so the last entry to go (or a crash) frees it
+    std::mutex files_mutex_;
+    std::map<std::string, std::weak_ptr<Entry::SpillFile>> files_;
+};
@@ -33,6 +33,7 @@ bool DataProcessor::LoadDataset() {
         
         // Store raw line as CSVRow
         data_.emplace_back(line);
+        data_bytes_ += line.size() + 1;
         row_count++;
         
         // Progress indicator for large files
@@ -4,6 +4,7 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
 
 // Generic CSV row - just stores raw line as string
 class CSVRow {
@@ -56,6 +57,11 @@ public:
     // Get total row count
     size_t GetTotalRows() const { return data_.size(); }
     
+    // Average size of one output row in bytes (used for task sizing)
+    double GetAverageRowBytes() const {
+        return data_.empty() ? 0.0 : static_cast<double>(data_bytes_) / data_.size();
+    }
+    
     // Process a chunk (returns CSV string with header + data)
     std::string ProcessChunk(const std::vector<CSVRow>& chunk, const std::string& filter_column = "", const std::string& filter_value = "");
     
@@ -66,4 +72,5 @@ private:
     std::string dataset_path_;
     std::string header_;
     std::vector<CSVRow> data_;
+    uint64_t data_bytes_ = 0;  // sum of row sizes incl. newline
 };
@@ -1,35 +1,64 @@
 // Handlers.cpp - gRPC service implementations for all node types
 // ClientGateway: StartRequest, GetNextChunk (used by clients)
 // TeamIngress: HandleRequest, PushWorkerResult (team coordination)
-// WorkerControl: RequestTask, ReportHealth (worker management)
+// WorkerControl: RequestTask, StreamTasks, ReportHealth (worker management)
 // NodeControl: Ping, Broadcast, Shutdown (health & control)
+// All services use the callback API; long work runs on bounded pools, never on callback threads.
 
 #include <grpcpp/grpcpp.h>
 #include "minitwo.grpc.pb.h"
 #include "RequestProcessor.h"
 #include "SessionManager.h"
+#include "ResultCache.h"
+#include "RequestCoalescer.h"
+#include "AdmissionController.h"
+#include "BoundedExecutor.h"
+#include "ArenaMessageAllocator.h"
 #include "../common/logging.h"
 #include <iostream>
 #include <string>
 #include <memory>
 #include <thread>
+#include <set>
+#include <functional>
 
-using grpc::ServerContext;
 using grpc::Status;
 
 // Global shutdown flag
 extern std::atomic<bool> g_shutdown_requested;
 
-class NodeControlService final : public mini2::NodeControl::Service {
+// Completes a unary callback RPC from inside its handler
+static grpc::ServerUnaryReactor* FinishNow(grpc::CallbackServerContext* ctx, const Status& status) {
+    auto* reactor = ctx->DefaultReactor();
+    reactor->Finish(status);
+    return reactor;
+}
+
+class NodeControlService final : public mini2::NodeControl::CallbackService {
 private:
     std::shared_ptr<RequestProcessor> processor_;
     std::string node_id_;
+    // InitiateShutdown sleeps through the grace period; it runs here, not on a callback thread
+    BoundedExecutor control_;
+    ArenaMessageAllocator<mini2::Heartbeat, mini2::HeartbeatAck> ping_messages_;  // every worker, every 3s
+    
+    void ShutdownInBackground(int delay_seconds) {
+        if (!control_.TrySubmit([this, delay_seconds]() {
+                processor_->InitiateShutdown(delay_seconds);
+                g_shutdown_requested = true;
+            })) {
+            g_shutdown_requested = true;  // already shutting down
+        }
+    }
     
 public:
     NodeControlService(std::shared_ptr<RequestProcessor> processor, const std::string& node_id)
-        : processor_(processor), node_id_(node_id) {}
+        : processor_(processor), node_id_(node_id), control_(node_id, 1, 4) {
+        SetMessageAllocatorFor_Ping(&ping_messages_);
+    }
     
-    Status Ping(ServerContext* ctx, const mini2::Heartbeat* req, mini2::HeartbeatAck* resp) override {
+    grpc::ServerUnaryReactor* Ping(grpc::CallbackServerContext* ctx, const mini2::Heartbeat* req,
+                                   mini2::HeartbeatAck* resp) override {
         LOG_DEBUG(node_id_, "NodeControl", 
                   "Ping from " + req->from() + " at " + std::to_string(req->ts_unix_ms()));
         
@@ -37,23 +66,24 @@ public:
         if (node_id_ == "B" || node_id_ == "E") {
             processor_->EnsureWorkerRegistered(req->from());
             if (req->recent_task_ms() > 0.0) {
-                processor_->UpdateWorkerHeartbeat(req->from(), req->recent_task_ms(), req->queue_len());
+                processor_->UpdateWorkerHeartbeat(req->from(), req->recent_task_ms(),
+                                                  req->recent_rows_per_sec(), req->queue_len());
             }
         }
         
         resp->set_ok(true);
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
     
-    Status Broadcast(ServerContext*, const mini2::BroadcastMessage* req, mini2::HeartbeatAck* resp) override {
+    grpc::ServerUnaryReactor* Broadcast(grpc::CallbackServerContext* ctx, const mini2::BroadcastMessage* req,
+                                        mini2::HeartbeatAck* resp) override {
         std::cout << "[NodeControl:" << node_id_ << "] Broadcast from " << req->from_node() 
                   << " type: " << req->message_type() << std::endl;
         
         // Handle different broadcast types
         if (req->message_type() == "shutdown") {
             std::cout << "[NodeControl:" << node_id_ << "] Received shutdown broadcast" << std::endl;
-            processor_->InitiateShutdown(3);  // 3 second delay
-            g_shutdown_requested = true;
+            ShutdownInBackground(3);  // 3 second delay
         } else if (req->message_type() == "status") {
             auto status = processor_->GetStatus();
             std::cout << "[NodeControl:" << node_id_ << "] Status: " << status.state() 
@@ -61,69 +91,280 @@ public:
         }
         
         resp->set_ok(true);
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
     
-    Status Shutdown(ServerContext*, const mini2::ShutdownRequest* req, mini2::ShutdownResponse* resp) override {
+    grpc::ServerUnaryReactor* Shutdown(grpc::CallbackServerContext* ctx, const mini2::ShutdownRequest* req,
+                                       mini2::ShutdownResponse* resp) override {
         std::cout << "[NodeControl:" << node_id_ << "] Shutdown request from " << req->from_node() 
                   << " with delay=" << req->delay_seconds() << "s" << std::endl;
         
-        processor_->InitiateShutdown(req->delay_seconds());
-        g_shutdown_requested = true;
+        ShutdownInBackground(req->delay_seconds());
         
         resp->set_acknowledged(true);
         resp->set_node_id(node_id_);
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
     
-    Status GetStatus(ServerContext*, const mini2::StatusRequest* req, mini2::StatusResponse* resp) override {
+    grpc::ServerUnaryReactor* GetStatus(grpc::CallbackServerContext* ctx, const mini2::StatusRequest* req,
+                                        mini2::StatusResponse* resp) override {
         *resp = processor_->GetStatus();
         std::cout << "[NodeControl:" << node_id_ << "] Status request from " << req->from_node() 
                   << " - State: " << resp->state() << std::endl;
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
+    }
+};
+
+// Team leader end of StreamTasks for one worker. Credits arrive as reads; tasks are
+// written one at a time while credits last. Besides its own read/write completions,
+// the service's dispatch thread calls Pump() whenever queued work may have changed.
+class TaskStreamReactor final : public grpc::ServerBidiReactor<mini2::TaskCredit, mini2::Task> {
+public:
+    using DoneFn = std::function<void(TaskStreamReactor*)>;
+    
+    TaskStreamReactor(std::shared_ptr<RequestProcessor> processor, const std::string& node_id, DoneFn on_done)
+        : processor_(std::move(processor)), node_id_(node_id), on_done_(std::move(on_done)) {
+        StartRead(&credit_);
+    }
+    
+    // Writes the next task if a credit is free and no write is in flight
+    void Pump() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_ || writing_ || credits_ <= 0 || worker_id_.empty()) return;
+        if (processor_->IsShuttingDown()) {
+            FinishLocked(Status::OK);
+            return;
+        }
+        mini2::Task task = processor_->RequestTaskForWorker(worker_id_);
+        if (task.request_id().empty()) return;
+        
+        out_ = std::move(task);
+        writing_ = true;
+        credits_--;
+        pushed_++;
+        LOG_DEBUG(node_id_, "TeamIngress", 
+                  "Pushed task " + out_.request_id() + "." + 
+                  std::to_string(out_.chunk_id()) + " to " + worker_id_);
+        StartWrite(&out_);
+    }
+    
+    void OnReadDone(bool ok) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ok) {
+                read_closed_ = true;
+                if (!writing_) FinishLocked(Status::OK);
+                return;
+            }
+            if (worker_id_.empty()) {
+                worker_id_ = credit_.worker_id();
+                processor_->EnsureWorkerRegistered(worker_id_);
+                LOG_INFO(node_id_, "TeamIngress", 
+                         "StreamTasks opened by " + worker_id_ + " (window=" + 
+                         std::to_string(credit_.credits()) + ")");
+            }
+            credits_ += credit_.credits();
+            if (!finished_) StartRead(&credit_);
+        }
+        Pump();
+    }
+    
+    void OnWriteDone(bool ok) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writing_ = false;
+            // A failed write leaves the task leased; lease expiry re-queues it
+            if (!ok || read_closed_) {
+                FinishLocked(Status::OK);
+                return;
+            }
+        }
+        Pump();
+    }
+    
+    void OnCancel() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FinishLocked(Status::CANCELLED);
+    }
+    
+    void OnDone() override {
+        LOG_INFO(node_id_, "TeamIngress", 
+                 "StreamTasks closed for " + worker_id_ + " (pushed=" + std::to_string(pushed_) + ")");
+        on_done_(this);
+        delete this;
     }
+    
+private:
+    void FinishLocked(const Status& status) {
+        if (finished_) return;
+        finished_ = true;
+        Finish(status);
+    }
+    
+    std::shared_ptr<RequestProcessor> processor_;
+    std::string node_id_;
+    DoneFn on_done_;
+    
+    std::mutex mutex_;
+    mini2::TaskCredit credit_;
+    mini2::Task out_;
+    std::string worker_id_;  // from the first credit message
+    int64_t credits_ = 0;
+    uint64_t pushed_ = 0;
+    bool writing_ = false;
+    bool read_closed_ = false;
+    bool finished_ = false;
+};
+
+// Frames of one UploadWorkerResult call; each frame is stored as its own result,
+// the part is never reassembled here
+class UploadReactor final : public grpc::ServerReadReactor<mini2::WorkerResult> {
+public:
+    UploadReactor(std::shared_ptr<RequestProcessor> processor, const std::string& node_id,
+                  mini2::HeartbeatAck* resp)
+        : processor_(std::move(processor)), node_id_(node_id), resp_(resp) {
+        StartRead(&frame_);
+    }
+    
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            LOG_DEBUG(node_id_, "TeamIngress", 
+                      "UploadWorkerResult: " + request_id_ + " part=" + 
+                      std::to_string(part_index_) + " frames=" + std::to_string(frames_));
+            resp_->set_ok(true);
+            Finish(Status::OK);
+            return;
+        }
+        request_id_ = frame_.request_id();
+        part_index_ = frame_.part_index();
+        processor_->ReceiveWorkerResult(std::move(frame_));  // StartRead re-parses into it
+        frames_++;
+        StartRead(&frame_);
+    }
+    
+    void OnDone() override { delete this; }
+    
+private:
+    std::shared_ptr<RequestProcessor> processor_;
+    std::string node_id_;
+    mini2::HeartbeatAck* resp_;
+    mini2::WorkerResult frame_;
+    std::string request_id_;  // of the last frame, for the log line (frame_ is moved out)
+    uint32_t part_index_ = 0;
+    uint32_t frames_ = 0;
 };
 
-class TeamIngressService final : public mini2::TeamIngress::Service {
+// Streaming RPC refused before any message is exchanged
+template <typename Reactor>
+class RefusedStream final : public Reactor {
+public:
+    explicit RefusedStream(const Status& status) { this->Finish(status); }
+    void OnDone() override { delete this; }
+};
+
+class TeamIngressService final : public mini2::TeamIngress::CallbackService {
 private:
     std::shared_ptr<RequestProcessor> processor_;
     std::string node_id_;
+    // HandleRequest waits for a whole team run; it must not sit on a callback thread
+    BoundedExecutor requests_;
+    
+    // Per-call arenas for the per-task RPCs. RequestTask keeps the default holder: its
+    // Task is moved out of a heap queue, which an arena response would turn into a copy.
+    ArenaMessageAllocator<mini2::WorkerResult, mini2::HeartbeatAck> result_messages_;
+    ArenaMessageAllocator<mini2::TaskComplete, mini2::HeartbeatAck> notice_messages_;
+    
+    // Team leaders: one thread pumps every open StreamTasks stream on dispatch changes
+    std::mutex streams_mutex_;
+    std::set<TaskStreamReactor*> streams_;
+    std::atomic<bool> stop_dispatch_{false};
+    std::thread dispatch_thread_;
+    
+    void DispatchLoop() {
+        while (!stop_dispatch_) {
+            uint64_t seq = processor_->DispatchSequence();
+            {
+                std::lock_guard<std::mutex> lock(streams_mutex_);
+                for (auto* stream : streams_) stream->Pump();
+            }
+            // The timeout bounds how long speculation and worker recovery go unnoticed
+            if (processor_->IsShuttingDown()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            } else {
+                processor_->WaitForDispatchChange(seq, std::chrono::milliseconds(100));
+            }
+        }
+    }
+    
 public:
-    TeamIngressService(std::shared_ptr<RequestProcessor> processor, const std::string& node_id) 
-        : processor_(processor), node_id_(node_id) {}
+    TeamIngressService(std::shared_ptr<RequestProcessor> processor, const std::string& node_id,
+                       const IngressConfig& ingress = IngressConfig()) 
+        : processor_(processor), node_id_(node_id),
+          requests_(node_id, ingress.request_threads, ingress.max_queued_requests) {
+        SetMessageAllocatorFor_PushWorkerResult(&result_messages_);
+        SetMessageAllocatorFor_ReportTaskComplete(&notice_messages_);
+        if (node_id_ == "B" || node_id_ == "E") {
+            dispatch_thread_ = std::thread([this]() { DispatchLoop(); });
+        }
+    }
+    
+    ~TeamIngressService() {
+        stop_dispatch_ = true;
+        if (dispatch_thread_.joinable()) {
+            dispatch_thread_.join();
+        }
+    }
     
-    Status HandleRequest(ServerContext* ctx, const mini2::Request* req, mini2::HeartbeatAck* resp) override {
+    grpc::ServerUnaryReactor* HandleRequest(grpc::CallbackServerContext* ctx, const mini2::Request* req,
+                                            mini2::HeartbeatAck* resp) override {
         std::cout << "[TeamIngress] HandleRequest: " << req->request_id() 
                   << " (green=" << req->need_green() << ", pink=" << req->need_pink() << ")" << std::endl;
         
-        // Determine if this is a team leader or worker
-        if (node_id_ == "B" || node_id_ == "E") {
-            LOG_INFO(node_id_, "TeamIngress",
-                     "HandleRequest: received Request for team leader with request_id=" +
-                     req->request_id() + " dataset=" + req->query());
-            // Team leaders forward to workers or process locally
-            processor_->HandleTeamRequest(*req);
-        } else {
-            // Workers process and send results back
-            processor_->HandleWorkerRequest(*req);
+        auto* reactor = ctx->DefaultReactor();
+        bool queued = requests_.TrySubmit([this, reactor, req, resp]() {
+            // Determine if this is a team leader or worker
+            if (node_id_ == "B" || node_id_ == "E") {
+                LOG_INFO(node_id_, "TeamIngress",
+                         "HandleRequest: received Request for team leader with request_id=" +
+                         req->request_id() + " dataset=" + req->query());
+                // Team leaders forward to workers or process locally;
+                // ok=false tells the leader the results are incomplete
+                processor_->HandleTeamRequest(*req);
+                resp->set_ok(processor_->ConsumeTeamRequestStatus(req->request_id()));
+            } else {
+                // Workers process and send results back
+                processor_->HandleWorkerRequest(*req);
+                resp->set_ok(true);
+            }
+            reactor->Finish(Status::OK);
+        });
+        if (!queued) {
+            LOG_WARN(node_id_, "TeamIngress", "HandleRequest refused for " + req->request_id() + ": pool full");
+            reactor->Finish(Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "too many requests in progress"));
         }
-        
-        resp->set_ok(true);
-        return Status::OK;
+        return reactor;
     }
     
-    Status PushWorkerResult(ServerContext* ctx, const mini2::WorkerResult* req, mini2::HeartbeatAck* resp) override {
+    grpc::ServerUnaryReactor* PushWorkerResult(grpc::CallbackServerContext* ctx, const mini2::WorkerResult* req,
+                                               mini2::HeartbeatAck* resp) override {
         std::cout << "[TeamIngress] PushWorkerResult: " << req->request_id() 
                   << " part=" << req->part_index() << std::endl;
         
-        // Store result in processor
+        // Store result in processor. The request message belongs to the call, so this
+        // is the one copy of the payload; everything after it moves or shares.
         processor_->ReceiveWorkerResult(*req);
         
         resp->set_ok(true);
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
     
-    Status RequestTask(ServerContext* ctx, const mini2::NodeId* req, mini2::Task* resp) override {
+    grpc::ServerReadReactor<mini2::WorkerResult>* UploadWorkerResult(grpc::CallbackServerContext*,
+                                                                      mini2::HeartbeatAck* resp) override {
+        return new UploadReactor(processor_, node_id_, resp);
+    }
+    
+    grpc::ServerUnaryReactor* RequestTask(grpc::CallbackServerContext* ctx, const mini2::NodeId* req,
+                                          mini2::Task* resp) override {
         LOG_DEBUG(node_id_, "TeamIngress", "RequestTask from " + req->id());
         
         // Only team leaders can assign tasks
@@ -137,41 +378,323 @@ public:
         }
         // else return empty task (default constructed)
         
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
+    }
+    
+    grpc::ServerBidiReactor<mini2::TaskCredit, mini2::Task>* StreamTasks(grpc::CallbackServerContext*) override {
+        // Only team leaders can assign tasks
+        if (node_id_ != "B" && node_id_ != "E") {
+            return new RefusedStream<grpc::ServerBidiReactor<mini2::TaskCredit, mini2::Task>>(
+                Status(grpc::StatusCode::UNIMPLEMENTED, "StreamTasks is served by team leaders"));
+        }
+        
+        auto* stream = new TaskStreamReactor(processor_, node_id_, [this](TaskStreamReactor* done) {
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            streams_.erase(done);
+        });
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        streams_.insert(stream);
+        return stream;
+    }
+    
+    grpc::ServerUnaryReactor* StealTasks(grpc::CallbackServerContext* ctx, const mini2::StealRequest* req,
+                                         mini2::StealResponse* resp) override {
+        LOG_DEBUG(node_id_, "TeamIngress", 
+                  "StealTasks from " + req->thief() + " (idle_workers=" + std::to_string(req->idle_workers()) + ")");
+        
+        if (node_id_ == "B" || node_id_ == "E") {
+            for (auto& task : processor_->GiveTasksToPeer(*req)) {
+                *resp->add_tasks() = std::move(task);
+            }
+        }
+        return FinishNow(ctx, Status::OK);
+    }
+    
+    grpc::ServerUnaryReactor* ReportTaskComplete(grpc::CallbackServerContext* ctx, const mini2::TaskComplete* req,
+                                                 mini2::HeartbeatAck* resp) override {
+        LOG_DEBUG(node_id_, "TeamIngress", 
+                  "ReportTaskComplete: " + req->request_id() + "." + std::to_string(req->chunk_id()) +
+                  " from " + req->worker_id());
+        
+        processor_->ReceiveTaskComplete(*req);
+        
+        resp->set_ok(true);
+        return FinishNow(ctx, Status::OK);
     }
 };
 
-class ClientGatewayService final : public mini2::ClientGateway::Service {
+// A GetNext waiting for its chunk. SessionManager completes it from AddChunk /
+// CompleteSession; a client that goes away unparks it.
+class ChunkWaitReactor final : public grpc::ServerUnaryReactor {
+public:
+    ChunkWaitReactor(std::shared_ptr<SessionManager> sessions, const mini2::NextChunkReq* req,
+                     mini2::NextChunkResp* resp)
+        : sessions_(std::move(sessions)), session_id_(req->request_id()) {
+        sessions_->GetNextChunkAsync(session_id_, req->next_index(), req->byte_offset(), resp, this,
+                                     [this](SessionManager::ChunkOutcome outcome) {
+            switch (outcome) {
+            case SessionManager::ChunkOutcome::RELEASED:
+                // Behind the re-read window: the client acknowledged it long ago
+                Finish(Status(grpc::StatusCode::OUT_OF_RANGE, "chunk already released"));
+                break;
+            case SessionManager::ChunkOutcome::READ_ERROR:
+                Finish(Status(grpc::StatusCode::INTERNAL, "chunk could not be read"));
+                break;
+            case SessionManager::ChunkOutcome::REJECTED:
+                Finish(Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "request rejected: gateway at capacity"));
+                break;
+            case SessionManager::ChunkOutcome::NOT_FOUND:
+                Finish(Status(grpc::StatusCode::NOT_FOUND, "session expired or unknown"));
+                break;
+            default:
+                Finish(Status::OK);
+            }
+        });
+    }
+    
+    void OnCancel() override {
+        if (sessions_->CancelChunkWait(session_id_, this)) {
+            Finish(Status::CANCELLED);
+        }
+    }
+    
+    void OnDone() override { delete this; }
+    
+private:
+    std::shared_ptr<SessionManager> sessions_;
+    std::string session_id_;
+};
+
+// Gateway end of FetchChunks for one client. Chunks are fetched and written one at a
+// time while credits last, so up to a window of them is on the wire without a round
+// trip per chunk; a chunk not produced yet parks the stream on its session like a GetNext.
+// The stream ends after the last chunk (or on the first that cannot be served).
+class ChunkStreamReactor final : public grpc::ServerBidiReactor<mini2::ChunkCredit, mini2::NextChunkResp> {
+public:
+    explicit ChunkStreamReactor(std::shared_ptr<SessionManager> sessions) : sessions_(std::move(sessions)) {
+        StartRead(&credit_);
+    }
+    
+    // Fetches the next chunk if a credit is free and nothing is in progress
+    void Pump() {
+        uint32_t index = 0;
+        uint32_t acked = 0;
+        uint64_t byte_offset = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_ || busy_ || credits_ <= 0 || session_id_.empty()) return;
+            busy_ = true;
+            index = next_index_;
+            acked = acked_;
+            byte_offset = byte_offset_;
+        }
+        out_.Clear();
+        sessions_->PrefetchChunkAsync(session_id_, index, byte_offset, acked, &out_, this,
+                                      [this](SessionManager::ChunkOutcome outcome) { OnChunk(outcome); });
+        
+        // A cancel between setting busy_ and parking found nothing to unpark; unpark now
+        // (if the fetch was answered meanwhile, OnChunk saw cancelled_ and finished)
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_ && !writing_ && sessions_->CancelChunkWait(session_id_, this)) {
+            FinishLocked(Status::CANCELLED);
+        }
+    }
+    
+    void OnReadDone(bool ok) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ok) {
+                read_closed_ = true;
+                if (!busy_) FinishLocked(Status::OK);
+                return;
+            }
+            if (session_id_.empty()) {
+                session_id_ = credit_.request_id();
+                next_index_ = acked_ = credit_.start_index();
+                byte_offset_ = credit_.byte_offset();
+                std::cout << "[ClientGateway] FetchChunks: " << session_id_ << " from chunk " << next_index_
+                          << " (window=" << credit_.credits() << ")" << std::endl;
+            } else {
+                acked_ += credit_.credits();  // one credit back per chunk consumed
+            }
+            credits_ += credit_.credits();
+            if (!finished_) StartRead(&credit_);
+        }
+        Pump();
+    }
+    
+    void OnWriteDone(bool ok) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_ = false;
+            writing_ = false;
+            if (!ok || cancelled_ || read_closed_) {
+                FinishLocked(ok && !cancelled_ ? Status::OK : Status::CANCELLED);
+                return;
+            }
+        }
+        Pump();
+    }
+    
+    void OnCancel() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A parked fetch is unparked here; one already completing finishes the stream itself
+        if (!busy_ || (!writing_ && sessions_->CancelChunkWait(session_id_, this))) {
+            FinishLocked(Status::CANCELLED);
+        } else {
+            cancelled_ = true;
+        }
+    }
+    
+    void OnDone() override {
+        std::cout << "[ClientGateway] FetchChunks closed for " << session_id_
+                  << " (sent=" << sent_ << ")" << std::endl;
+        delete this;
+    }
+    
+private:
+    void OnChunk(SessionManager::ChunkOutcome outcome) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            FinishLocked(Status::CANCELLED);
+            return;
+        }
+        switch (outcome) {
+        case SessionManager::ChunkOutcome::FOUND:
+            credits_--;
+            next_index_++;
+            byte_offset_ = 0;
+            sent_++;
+            writing_ = true;
+            StartWrite(&out_);
+            break;
+        case SessionManager::ChunkOutcome::RELEASED:
+            FinishLocked(Status(grpc::StatusCode::OUT_OF_RANGE, "chunk already released"));
+            break;
+        case SessionManager::ChunkOutcome::READ_ERROR:
+            FinishLocked(Status(grpc::StatusCode::INTERNAL, "chunk could not be read"));
+            break;
+        case SessionManager::ChunkOutcome::REJECTED:
+            FinishLocked(Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "request rejected: gateway at capacity"));
+            break;
+        case SessionManager::ChunkOutcome::NOT_FOUND:
+            FinishLocked(Status(grpc::StatusCode::NOT_FOUND, "session expired or unknown"));
+            break;
+        default:
+            FinishLocked(Status::OK);  // past the last chunk
+        }
+    }
+    
+    void FinishLocked(const Status& status) {
+        if (finished_) return;
+        finished_ = true;
+        Finish(status);
+    }
+    
+    std::shared_ptr<SessionManager> sessions_;
+    
+    std::mutex mutex_;
+    mini2::ChunkCredit credit_;
+    mini2::NextChunkResp out_;
+    std::string session_id_;  // from the first credit message
+    uint32_t next_index_ = 0;
+    uint32_t acked_ = 0;      // chunks below this the client has consumed
+    uint64_t byte_offset_ = 0;
+    int64_t credits_ = 0;
+    uint64_t sent_ = 0;
+    bool busy_ = false;       // fetch or write in progress
+    bool writing_ = false;
+    bool read_closed_ = false;
+    bool cancelled_ = false;
+    bool finished_ = false;
+};
+
+class ClientGatewayService final : public mini2::ClientGateway::CallbackService {
 private:
     std::shared_ptr<RequestProcessor> processor_;
     std::shared_ptr<SessionManager> session_manager_;
+    std::shared_ptr<ResultCache> result_cache_;  // null = caching off
+    RequestCoalescer coalescer_;
+    bool coalesce_;
+    AdmissionController admission_;
+    // One thread per admission slot; declared after admission_ so its jobs are joined first
+    BoundedExecutor executor_;
+    std::atomic<bool> draining_{false};
+    
+    // Per-call arenas for the chunk fetches every client issues in a loop
+    ArenaMessageAllocator<mini2::NextChunkReq, mini2::NextChunkResp> next_messages_;
+    ArenaMessageAllocator<mini2::PollReq, mini2::PollResp> poll_messages_;
+    
+    // Admission launcher: runs a job on the bounded pool. The pool is sized so this
+    // cannot overflow; if it ever does (or the pool is draining) the job runs inline
+    // rather than leaking its admission slot.
+    void Launch(AdmissionController::Job job) {
+        auto shared = std::make_shared<AdmissionController::Job>(std::move(job));
+        if (!executor_.TrySubmit([shared]() { (*shared)(); })) {
+            LOG_WARN("A", "ClientGateway", "Request pool unavailable; running request inline");
+            (*shared)();
+        }
+    }
+    
+    // Shares a finished result set with a session (no payload copies) and marks it complete
+    void FillSession(const std::string& session_id, const ResultCache::Results& results) {
+        session_manager_->AddChunks(session_id, results);
+        session_manager_->CompleteSession(session_id);
+    }
     
 public:
     ClientGatewayService(std::shared_ptr<RequestProcessor> processor,
-                         std::shared_ptr<SessionManager> session_mgr) 
-        : processor_(processor), session_manager_(session_mgr) {}
+                         std::shared_ptr<SessionManager> session_mgr,
+                         std::shared_ptr<ResultCache> result_cache = nullptr,
+                         const GatewayConfig& gateway = GatewayConfig()) 
+        : processor_(processor), session_manager_(session_mgr), result_cache_(result_cache),
+          coalesce_(gateway.coalesce_requests),
+          admission_("A", gateway.max_running_requests, gateway.max_queued_requests,
+                     [this](AdmissionController::Job job) { Launch(std::move(job)); }),
+          // A finishing job hands its slot on from inside the pool, so one queue
+          // entry per thread is all the admission controller ever needs
+          executor_("A", std::max<uint32_t>(1, gateway.max_running_requests),
+                    std::max<uint32_t>(1, gateway.max_running_requests)) {
+        SetMessageAllocatorFor_GetNext(&next_messages_);
+        SetMessageAllocatorFor_PollNext(&poll_messages_);
+    }
     
-    Status OpenSession(ServerContext*, const mini2::SessionOpen* req, mini2::HeartbeatAck* resp) override {
+    // Stops admitting, waits for running and queued requests, then joins the pool
+    bool Drain(std::chrono::milliseconds timeout) {
+        draining_ = true;
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (std::chrono::steady_clock::now() < deadline) {
+            auto stats = admission_.GetStats();
+            if (stats.running == 0 && stats.queued == 0) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        return executor_.Shutdown(std::max(remaining, std::chrono::milliseconds(0)));
+    }
+    
+    grpc::ServerUnaryReactor* OpenSession(grpc::CallbackServerContext* ctx, const mini2::SessionOpen* req,
+                                          mini2::HeartbeatAck* resp) override {
         std::cout << "[ClientGateway] OpenSession: " << req->request_id() << std::endl;
         resp->set_ok(true); 
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
     
-    Status GetNext(ServerContext*, const mini2::NextChunkReq* req, mini2::NextChunkResp* resp) override {
+    grpc::ServerUnaryReactor* GetNext(grpc::CallbackServerContext*, const mini2::NextChunkReq* req,
+                                      mini2::NextChunkResp* resp) override {
         std::cout << "[ClientGateway] GetNext: " << req->request_id() 
                   << " index=" << req->next_index() << std::endl;
         
-        bool success = session_manager_->GetNextChunk(req->request_id(), req->next_index(), resp);
-        
-        if (!success) {
-            resp->set_has_more(false);
-        }
-        
-        return Status::OK;
+        // Parked on the session until the chunk exists; no thread is held meanwhile
+        return new ChunkWaitReactor(session_manager_, req, resp);
     }
     
-    Status StartRequest(ServerContext*, const mini2::Request* req, mini2::SessionOpen* out) override {
+    grpc::ServerUnaryReactor* StartRequest(grpc::CallbackServerContext* ctx, const mini2::Request* req,
+                                           mini2::SessionOpen* out) override {
         std::cout << "[ClientGateway] start: " << req->request_id() << std::endl;
+        if (draining_) {
+            return FinishNow(ctx, Status(grpc::StatusCode::UNAVAILABLE, "gateway is shutting down"));
+        }
         
         // Create session with unique ID
         std::string session_id = session_manager_->CreateSession(*req);
@@ -181,8 +704,30 @@ public:
         out->set_timestamp_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count());
         
-        // Start background processing
-        std::thread([this, session_id, req = *req]() {
+        // Same dataset version and query answered before: serve it without a fan-out
+        std::string cache_key = result_cache_ ? ResultCache::MakeKey(*req) : std::string();
+        if (auto cached = result_cache_ ? result_cache_->Lookup(cache_key) : nullptr) {
+            FillSession(session_id, cached);
+            out->set_status("CACHED");
+            
+            auto stats = result_cache_->GetStats();
+            std::cout << "[ClientGateway] served " << session_id << " from cache ("
+                      << cached->size() << " chunks, hits=" << stats.hits
+                      << " misses=" << stats.misses << ")" << std::endl;
+            return FinishNow(ctx, Status::OK);
+        }
+        
+        // Identical request already running: ride along with it
+        std::string flight_key = RequestCoalescer::KeyFor(*req);
+        if (coalesce_ && !coalescer_.Join(flight_key, session_id)) {
+            out->set_status("PROCESSING");
+            std::cout << "[ClientGateway] session " << session_id 
+                      << " attached to in-flight request for " << req->query() << std::endl;
+            return FinishNow(ctx, Status::OK);
+        }
+        
+        // Run now, wait in the admission queue, or fail fast when the queue is full
+        auto decision = admission_.Submit(session_id, [this, session_id, cache_key, flight_key, req = *req]() {
             std::cout << "[ClientGateway] background processing for session " 
                       << session_id << std::endl;
             
@@ -191,47 +736,118 @@ public:
             mini2::Request unique_req = req;
             unique_req.set_request_id(session_id);
             
+            // Stream results into the session as they arrive at the gateway, so the
+            // client's first GetNext does not wait for the whole answer
+            RequestProcessor::ResultListener stream;
+            stream.on_result = [this, &session_id](const RequestProcessor::Result& result) {
+                session_manager_->AddChunk(session_id, result);
+            };
+            stream.on_team_done = [this, &session_id]() { session_manager_->FlushOrdered(session_id); };
+            
             // Process request with unique request_id
-            auto results = processor_->ProcessRequest(unique_req);
+            bool complete = false;
+            ResultCache::Results results = std::make_shared<const std::vector<RequestProcessor::Result>>(
+                processor_->ProcessRequest(unique_req, &complete, &stream));
             
-            // Add each chunk to session
-            for (const auto& result : results) {
-                mini2::WorkerResult wr;
-                wr.set_request_id(session_id);
-                wr.set_part_index(result.part_index());
-                wr.set_payload(result.payload());
-                session_manager_->AddChunk(session_id, wr);
+            // Only full answers are cached; partial ones would be served forever.
+            // Cache before closing the flight so late arrivals hit one or the other.
+            if (result_cache_ && complete && !results->empty()) {
+                result_cache_->Insert(cache_key, results);
             }
             
-            // Mark session complete
-            session_manager_->CompleteSession(session_id);
+            // The leader session already has its chunks; sessions that attached while
+            // the request ran get the whole set now
+            std::vector<std::string> sessions = coalesce_ ? coalescer_.Finish(flight_key)
+                                                          : std::vector<std::string>{session_id};
+            for (const auto& sid : sessions) {
+                if (sid == session_id) session_manager_->CompleteSession(sid);
+                else FillSession(sid, results);
+            }
             
-            std::cout << "[ClientGateway] background done for session " 
-                      << session_id << std::endl;
-        }).detach();
+            // The sessions (and the cache) hold the chunks now; what only they hold can spill
+            results.reset();
+            session_manager_->TrimChunks();
+            
+            auto pool = executor_.GetStats();
+            std::cout << "[ClientGateway] background done for session " << session_id;
+            if (sessions.size() > 1) {
+                std::cout << " (+" << sessions.size() - 1 << " coalesced)";
+            }
+            std::cout << " [pool active=" << pool.active << "/" << pool.threads
+                      << " queued=" << pool.queued << " max_queued=" << pool.max_queued
+                      << " avg_wait=" << static_cast<long>(pool.avg_wait_ms) << "ms]" << std::endl;
+        }, ScheduleKeyOf(*req));
+        
+        switch (decision.outcome) {
+        case AdmissionController::Outcome::RUNNING:
+            out->set_status("PROCESSING");
+            break;
+        case AdmissionController::Outcome::QUEUED:
+            out->set_status("QUEUED");
+            out->set_queue_position(decision.queue_position);
+            out->set_eta_ms(decision.eta_ms);
+            break;
+        case AdmissionController::Outcome::REJECTED: {
+            // Sessions that attached in the meantime were told PROCESSING: their fetches
+            // fail with RESOURCE_EXHAUSTED rather than finding an empty result
+            std::vector<std::string> sessions = coalesce_ ? coalescer_.Finish(flight_key)
+                                                          : std::vector<std::string>{session_id};
+            for (const auto& sid : sessions) {
+                if (sid != session_id) session_manager_->RejectSession(sid);
+            }
+            session_manager_->CleanupSession(session_id);
+            out->set_accepted(false);
+            out->set_status("REJECTED");
+            out->set_eta_ms(decision.eta_ms);  // retry hint
+            break;
+        }
+        }
         
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
 
-    Status PollNext(ServerContext*, const mini2::PollReq* req, mini2::PollResp* resp) override {
+    grpc::ServerUnaryReactor* PollNext(grpc::CallbackServerContext* ctx, const mini2::PollReq* req,
+                                       mini2::PollResp* resp) override {
         std::cout << "[ClientGateway] PollNext: " << req->request_id() << std::endl;
         
-        bool success = session_manager_->PollNextChunk(req->request_id(), resp);
+        bool rejected = false;
+        bool success = session_manager_->PollNextChunk(req->request_id(), resp, &rejected);
+        if (rejected) {
+            return FinishNow(ctx, Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "request rejected: gateway at capacity"));
+        }
+        if (success && !resp->ready()) {
+            resp->set_queue_position(admission_.PositionOf(req->request_id()));
+        }
         
         if (!success) {
             resp->set_ready(false);
             resp->set_has_more(false);
         }
         
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
+    }
+    
+    grpc::ServerBidiReactor<mini2::ChunkCredit, mini2::NextChunkResp>* FetchChunks(grpc::CallbackServerContext*) override {
+        return new ChunkStreamReactor(session_manager_);
+    }
+    
+    grpc::ServerUnaryReactor* ResumeSession(grpc::CallbackServerContext* ctx, const mini2::ContinuationToken* req,
+                                            mini2::ResumeResp* resp) override {
+        std::cout << "[ClientGateway] ResumeSession: " << req->session_id()
+                  << " chunk=" << req->chunk_index() << " byte=" << req->byte_offset() << std::endl;
+        
+        // A refusal is an answer, not a transport error: the client starts over
+        session_manager_->ResumeSession(*req, resp);
+        return FinishNow(ctx, Status::OK);
     }
     
-    Status CloseSession(ServerContext*, const mini2::CloseSessionReq* req, mini2::CloseSessionResp* resp) override {
+    grpc::ServerUnaryReactor* CloseSession(grpc::CallbackServerContext* ctx, const mini2::CloseSessionReq* req,
+                                           mini2::CloseSessionResp* resp) override {
         std::cout << "[ClientGateway] CloseSession: " << req->session_id() << std::endl;
         
         session_manager_->CleanupSession(req->session_id());
         resp->set_success(true);
         
-        return Status::OK;
+        return FinishNow(ctx, Status::OK);
     }
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "minitwo.pb.h"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+
+// Order shared by every scheduling point (gateway admission queue, team leader
+// queues, worker prefetch): priority class first, then earliest deadline, then arrival.
+struct ScheduleKey {
+    int rank = 1;             // 0 = interactive, 1 = normal, 2 = batch
+    int64_t deadline_ms = 0;  // absolute unix ms, 0 = none
+};
+
+inline int PriorityRank(mini2::Priority priority) {
+    switch (priority) {
+        case mini2::PRIORITY_INTERACTIVE: return 0;
+        case mini2::PRIORITY_BATCH: return 2;
+        default: return 1;
+    }
+}
+
+// Works for mini2::Request and mini2::Task
+template <typename Message>
+ScheduleKey ScheduleKeyOf(const Message& msg) {
+    return ScheduleKey{PriorityRank(msg.priority()), msg.deadline_ms()};
+}
+
+// True if `a` must run strictly before `b`; work without a deadline goes last in its class
+inline bool RunsBefore(const ScheduleKey& a, const ScheduleKey& b) {
+    if (a.rank != b.rank) return a.rank < b.rank;
+    const int64_t none = std::numeric_limits<int64_t>::max();
+    return (a.deadline_ms > 0 ? a.deadline_ms : none) < (b.deadline_ms > 0 ? b.deadline_ms : none);
+}
+
+// Inserts keeping `queue` in RunsBefore order. New work goes behind its equals (FIFO);
+// `ahead_of_equals` puts it in front of them, for re-executions that already waited once.
+template <typename T, typename KeyFn>
+void InsertOrdered(std::deque<T>& queue, T item, KeyFn key_of, bool ahead_of_equals = false) {
+    const ScheduleKey key = key_of(item);
+    auto pos = ahead_of_equals
+        ? std::find_if(queue.begin(), queue.end(), [&](const T& q) { return !RunsBefore(key_of(q), key); })
+        : std::find_if(queue.begin(), queue.end(), [&](const T& q) { return RunsBefore(key, key_of(q)); });
+    queue.insert(pos, std::move(item));
+}
+
+inline void InsertTask(std::deque<mini2::Task>& queue, mini2::Task task, bool ahead_of_equals = false) {
+    InsertOrdered(queue, std::move(task), [](const mini2::Task& t) { return ScheduleKeyOf(t); },
+                  ahead_of_equals);
+}
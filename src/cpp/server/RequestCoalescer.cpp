@@ -0,0 +1,36 @@
+// RequestCoalescer.cpp - Single-flight execution of identical concurrent requests
+
+#include "RequestCoalescer.h"
+#include "ResultCache.h"
+
+std::string RequestCoalescer::KeyFor(const mini2::Request& request) {
+    std::string key = ResultCache::MakeKey(request);
+    if (key.empty()) {
+        key = request.query() + "|" + (request.need_green() ? "G" : "-") + (request.need_pink() ? "P" : "-");
+    }
+    // An interactive request must not wait behind a queued batch copy of itself
+    return key + "|p" + std::to_string(request.priority());
+}
+
+bool RequestCoalescer::Join(const std::string& key, const std::string& session_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& sessions = flights_[key];
+    sessions.push_back(session_id);
+    return sessions.size() == 1;
+}
+
+std::vector<std::string> RequestCoalescer::Finish(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> sessions;
+    auto it = flights_.find(key);
+    if (it != flights_.end()) {
+        sessions = std::move(it->second);
+        flights_.erase(it);
+    }
+    return sessions;
+}
+
+size_t RequestCoalescer::InFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flights_.size();
+}
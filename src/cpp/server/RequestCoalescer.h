@@ -0,0 +1,31 @@
+#pragma once
+
+#include "minitwo.grpc.pb.h"
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Single-flight for the gateway (A): identical requests that arrive while one is
+// already executing attach to it instead of starting another cluster-wide run.
+// Every attached session still gets its own copy of the chunks and its own cursor.
+class RequestCoalescer {
+public:
+    // Dataset version + query when the dataset is visible here, else the query alone;
+    // plus the priority class
+    static std::string KeyFor(const mini2::Request& request);
+
+    // True if session_id leads a new flight (the caller must execute the request);
+    // false if it was attached to the flight already running for `key`.
+    bool Join(const std::string& key, const std::string& session_id);
+
+    // Closes the flight and returns the sessions attached to it, leader first.
+    // Requests arriving after this start a new flight.
+    std::vector<std::string> Finish(const std::string& key);
+
+    size_t InFlight() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::vector<std::string>> flights_;  // key -> sessions
+};
@@ -3,6 +3,9 @@
 // Features: configurable timeouts, partial success, capacity-aware scheduling
 
 #include "RequestProcessor.h"
+#include "TaskPlanner.h"
+#include "Scheduler.h"
+#include "ArenaMessageAllocator.h"
 #include "../common/logging.h"
 #include <iostream>
 #include <chrono>
@@ -45,6 +48,24 @@ const std::chrono::milliseconds kLeaderWaitTimeoutMs =
     GetEnvMs("MINI3_LEADER_TIMEOUT_MS",
              std::chrono::milliseconds(12000));  // default 12s
 
+// Task leases: a dispatched task is re-queued if its worker has not finished it
+// within kTaskLeaseFactor x the expected task time (never less than the minimum,
+// never more than the maximum), counted from when the tasks queued ahead of it on
+// that worker should be done (PlanTaskLease)
+const std::chrono::milliseconds kTaskLeaseMinMs =
+    GetEnvMs("MINI3_TASK_LEASE_MIN_MS",
+             std::chrono::milliseconds(2000));   // default 2s
+
+const std::chrono::milliseconds kTaskLeaseDefaultMs =
+    GetEnvMs("MINI3_TASK_LEASE_DEFAULT_MS",
+             std::chrono::milliseconds(5000));   // default 5s, used before a worker has history
+
+constexpr double kTaskLeaseFactor = 3.0;
+
+// Half the team leader's wait, so a task lost on a crashed worker is re-run (and has
+// time to finish) before the team leader gives up on the request
+const std::chrono::milliseconds kTaskLeaseMaxMs = kTeamLeaderWaitTimeoutMs / 2;
+
 // Helper to get slowdown for worker D (simulates weak hardware)
 int getSlowdownMsForNode(const std::string& node_id) {
     const char* env = std::getenv("MINI3_SLOW_D_MS");
@@ -90,6 +111,7 @@ using grpc::Status;
 
 RequestProcessor::RequestProcessor(const std::string& node_id) 
     : node_id_(node_id)
+    , channels_(node_id, MakeLargeMessageArgs())
     , shutting_down_(false)
     , requests_processed_(0)
     , start_time_(std::chrono::steady_clock::now()) {
@@ -133,11 +155,70 @@ void RequestProcessor::SetWorkers(const std::map<std::string, std::pair<std::str
 }
 
 void RequestProcessor::SetLeaderAddress(const std::string& leader_address) {
-    auto channel = grpc::CreateCustomChannel(leader_address, grpc::InsecureChannelCredentials(), MakeLargeMessageArgs());
-    leader_stub_ = mini2::TeamIngress::NewStub(channel);
+    channels_.Register(leader_address);
+    leader_address_ = leader_address;
+    leader_stub_ = channels_.Control(leader_address);
     std::cout << "[RequestProcessor] Connected to leader: " << leader_address << std::endl;
 }
 
+void RequestProcessor::SetTaskSizing(const TaskSizingConfig& task_sizing) {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    task_sizing_ = task_sizing;
+    LOG_INFO(node_id_, "RequestProcessor",
+             "Task sizing policy=" + task_sizing_.policy +
+             " target_bytes=" + std::to_string(task_sizing_.target_task_bytes) +
+             " target_ms=" + std::to_string(task_sizing_.target_task_ms));
+}
+
+void RequestProcessor::SetResultSink(const std::string& gateway_address) {
+    result_sink_ = gateway_address;
+    LOG_INFO(node_id_, "RequestProcessor",
+             "Direct data path enabled: workers push results to " + gateway_address);
+}
+
+void RequestProcessor::SetUploadFrameBytes(uint64_t frame_bytes) {
+    upload_frame_bytes_ = frame_bytes;
+}
+
+void RequestProcessor::SetSpeculation(const SpeculationConfig& speculation) {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    speculation_ = speculation;
+    LOG_INFO(node_id_, "RequestProcessor",
+             std::string("Speculative backups ") + (speculation_.enabled ? "enabled" : "disabled") +
+             " (after_fraction=" + std::to_string(speculation_.after_fraction) +
+             ", straggler_factor=" + std::to_string(speculation_.straggler_factor) + ")");
+}
+
+void RequestProcessor::SetPeerTeamLeaders(const std::map<std::string, std::string>& peers) {
+    peer_team_leaders_ = peers;
+    for (const auto& [id, addr] : peers) {
+        RegisterPeer(addr, peer_stubs_, "peer team leader");
+    }
+}
+
+void RequestProcessor::SetChannelPool(const ChannelPoolConfig& pool) {
+    channels_.Configure(pool);
+    LOG_INFO(node_id_, "RequestProcessor",
+             "Channel pool: 1 control + " + std::to_string(pool.bulk_channels) + " bulk connection(s) per peer");
+}
+
+std::shared_ptr<grpc::Channel> RequestProcessor::ControlChannel(const std::string& addr) {
+    return channels_.ControlChannel(addr);
+}
+
+bool RequestProcessor::WarmUpChannels(std::chrono::milliseconds timeout) {
+    return channels_.WarmUp(timeout);
+}
+
+void RequestProcessor::SetCrossTeamSteal(const CrossTeamStealConfig& steal) {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    cross_steal_ = steal;
+    LOG_INFO(node_id_, "RequestProcessor",
+             std::string("Cross-team stealing ") + (cross_steal_.enabled ? "enabled" : "disabled") +
+             " (watermark_per_worker=" + std::to_string(cross_steal_.watermark_per_worker) +
+             ", max_batch=" + std::to_string(cross_steal_.max_batch) + ")");
+}
+
 void RequestProcessor::LoadDataset(const std::string& dataset_path) {
     std::lock_guard<std::mutex> lock(dataset_mutex_);
 
@@ -187,13 +268,22 @@ void RequestProcessor::LoadDatasetIfNeeded(const mini2::Request& request) {
 // Process A: Leader Request Handling
 // ============================================================================
 
-std::vector<mini2::WorkerResult> RequestProcessor::ProcessRequest(const mini2::Request& request) {
+std::vector<RequestProcessor::Result> RequestProcessor::ProcessRequest(const mini2::Request& request, bool* complete,
+                                                                     const ResultListener* listener) {
     std::cout << "[Leader] request: " << request.request_id() 
               << " green=" << request.need_green() 
               << " pink=" << request.need_pink() << std::endl;
+    
+    // Results arriving from here on are also streamed to the caller
+    if (listener) {
+        std::lock_guard<std::mutex> lock(results_mutex_);
+        result_listeners_[request.request_id()] = ListenerSlot{listener};
+    }
 
     // Forward to team leaders
-    int expected_results = ForwardToTeamLeaders(request, request.need_green(), request.need_pink());
+    int complete_teams = 0;
+    int expected_results = ForwardToTeamLeaders(request, request.need_green(), request.need_pink(),
+                                                &complete_teams, listener);
     
     std::cout << "[Leader] waiting for " << expected_results << " team-leader result(s)" << std::endl;
 
@@ -224,13 +314,29 @@ std::vector<mini2::WorkerResult> RequestProcessor::ProcessRequest(const mini2::R
         failed_reasons.push_back("Leader timeout (" + std::to_string(kLeaderWaitTimeoutMs.count()) + "ms)");
     }
     
+    const int requested_teams = (request.need_green() ? 1 : 0) + (request.need_pink() ? 1 : 0);
+    if (complete) {
+        *complete = got_results && expected_results > 0 && complete_teams >= requested_teams;
+    }
+    
+    // Stop streaming; a result being handed over right now finishes first
+    auto slot = result_listeners_.find(request.request_id());
+    if (slot != result_listeners_.end()) {
+        results_cv_.wait(lock, [&slot]() { return slot->second.busy == 0; });
+        result_listeners_.erase(slot);
+    }
+    
     // Collect results (lock already held from wait_for)
-    std::vector<mini2::WorkerResult> results;
+    std::vector<Result> results;
     
-    if (pending_results_.count(request.request_id())) {
-        results = pending_results_[request.request_id()];
-        pending_results_.erase(request.request_id());
+    auto pending = pending_results_.find(request.request_id());
+    if (pending != pending_results_.end()) {
+        results = std::move(pending->second);
+        pending_results_.erase(pending);
     }
+    completed_chunks_.erase(request.request_id());
+    part_deliveries_.erase(request.request_id());
+    MarkRequestFinished(request.request_id());
     
     // Log outcome based on success/failure
     if (successful_teams > 0 && successful_teams < total_teams) {
@@ -261,7 +367,8 @@ std::vector<mini2::WorkerResult> RequestProcessor::ProcessRequest(const mini2::R
     return results;
 }
 
-int RequestProcessor::ForwardToTeamLeaders(const mini2::Request& req, bool need_green, bool need_pink) {
+int RequestProcessor::ForwardToTeamLeaders(const mini2::Request& req, bool need_green, bool need_pink,
+                                           int* complete_teams, const ResultListener* listener) {
     int forwarded = 0;
     for (auto& [addr, stub] : team_leader_stubs_) {
         ClientContext ctx;
@@ -279,10 +386,22 @@ int RequestProcessor::ForwardToTeamLeaders(const mini2::Request& req, bool need_
             if (status.ok()) {
                 std::cout << "[Leader] Forwarded to team leader: " << addr << std::endl;
                 forwarded++;
+                if (complete_teams && ack.ok()) (*complete_teams)++;
             } else {
                 std::cerr << "[Leader] Failed to forward to " << addr << ": " 
                          << status.error_message() << std::endl;
             }
+            // HandleRequest returns once the team is done, so whatever it produced is in;
+            // wait for on_result calls still handing its chunks over outside the lock
+            if (listener && listener->on_team_done) {
+                std::unique_lock<std::mutex> lock(results_mutex_);
+                results_cv_.wait(lock, [this, &req]() {
+                    auto slot = result_listeners_.find(req.request_id());
+                    return slot == result_listeners_.end() || slot->second.busy == 0;
+                });
+                lock.unlock();
+                listener->on_team_done();
+            }
         }
     }
     std::cout << "[Leader] Forwarded request to " << forwarded << " team leader(s)" << std::endl;
@@ -341,8 +460,7 @@ void RequestProcessor::HandleTeamRequest(const mini2::Request& request) {
         
         // Create tasks for workers to pull
         size_t total_rows = proc->GetTotalRows();
-        size_t num_workers = worker_stats_.size();
-        size_t num_tasks = num_workers * 3; // 3 tasks per worker
+        size_t num_tasks = 0;
         
         if (total_rows == 0) {
             LOG_WARN(node_id_, "TeamLeader", "Dataset has 0 rows, cannot create tasks");
@@ -350,37 +468,75 @@ void RequestProcessor::HandleTeamRequest(const mini2::Request& request) {
             constexpr uint32_t kLocalPartitions = 2;
             ProcessLocally(proc, request, kLocalPartitions);
         } else {
-            size_t rows_per_task = (total_rows + num_tasks - 1) / num_tasks;
-            
-            // Clear old tasks and create new ones with capacity-aware assignment
+            // Create tasks with capacity-aware assignment. Tasks of other requests stay
+            // queued; the queues order everything by priority and deadline.
             {
                 std::lock_guard<std::mutex> lock(task_mutex_);
-                team_task_queue_.clear();
                 
-                // Clear worker queues for new request
-                for (auto& [worker_id, queue] : worker_queues_) {
-                    queue.clear();
-                    worker_stats_[worker_id].queue_len = 0;
+                // Fresh work on both teams: steal again as soon as our workers run dry
+                steal_backoff_ = 1;
+                next_steal_attempt_ = std::chrono::steady_clock::now();
+                
+                // Size tasks from dataset size, row width and measured worker throughput
+                std::vector<double> worker_rates;
+                for (const auto& [worker_id, ws] : worker_stats_) {
+                    if (ws.healthy) {
+                        worker_rates.push_back(ws.rows_per_sec);
+                    }
                 }
+                std::vector<TaskRange> ranges =
+                    PlanTaskRanges(task_sizing_, total_rows, proc->GetAverageRowBytes(), worker_rates);
                 
-                for (size_t i = 0; i < num_tasks; ++i) {
-                    size_t start_row = i * rows_per_task;
-                    if (start_row >= total_rows) break;
-                    
-                    size_t num_rows = std::min(rows_per_task, total_rows - start_row);
+                // Cost model: rows split by estimated throughput so all workers finish
+                // together; "greedy" keeps the original one-task-at-a-time pick
+                // (only queued work this request does not overtake counts as backlog)
+                const ScheduleKey request_key = ScheduleKeyOf(request);
+                std::vector<WorkerProfile> profiles = BuildWorkerProfiles(request_key);
+                std::vector<std::string> owners(ranges.size());
+                if (task_sizing_.assignment != "greedy" && !profiles.empty()) {
+                    uint64_t max_task_rows = 0;
+                    for (const auto& r : ranges) max_task_rows = std::max(max_task_rows, r.num_rows);
+                    Schedule sched = PlanSchedule(total_rows, max_task_rows, profiles);
+                    ranges = sched.tasks;
+                    owners.assign(ranges.size(), std::string());
+                    for (size_t i = 0; i < ranges.size(); ++i) {
+                        owners[i] = profiles[sched.worker_for_task[i]].id;
+                    }
                     
+                    std::ostringstream predicted;
+                    for (size_t i = 0; i < profiles.size(); ++i) {
+                        predicted << (i ? " " : "") << profiles[i].id << "="
+                                  << static_cast<long>(sched.finish_ms[i]) << "ms";
+                    }
+                    LOG_INFO(node_id_, "TeamLeader",
+                             "Cost-model schedule for " + request.request_id() + ": predicted finish " +
+                             predicted.str() + " (makespan " + 
+                             std::to_string(static_cast<long>(sched.makespan_ms)) + "ms)");
+                }
+                num_tasks = ranges.size();
+                request_task_totals_[request.request_id()] = num_tasks;
+                
+                LOG_INFO(node_id_, "TeamLeader",
+                         "Task plan (" + task_sizing_.policy + ") for " + request.request_id() +
+                         ": " + DescribePlan(ranges) +
+                         " avg_row_bytes=" + std::to_string(proc->GetAverageRowBytes()));
+                
+                for (size_t i = 0; i < ranges.size(); ++i) {
                     mini2::Task task;
                     task.set_request_id(request.request_id());
                     task.set_session_id(request.request_id()); // Use request_id as session_id
                     task.set_chunk_id(i);
-                    task.set_start_row(start_row);
-                    task.set_num_rows(num_rows);
+                    task.set_start_row(ranges[i].start_row);
+                    task.set_num_rows(ranges[i].num_rows);
                     task.set_dataset_path(request.query());
+                    task.set_result_sink(result_sink_);
+                    task.set_origin(node_id_);
+                    task.set_priority(request.priority());
+                    task.set_deadline_ms(request.deadline_ms());
                     
-                    // Use capacity-aware assignment instead of team queue
-                    std::string best_id = ChooseBestWorkerId();
+                    std::string best_id = owners[i].empty() ? ChooseBestWorkerId(task) : owners[i];
                     if (!best_id.empty()) {
-                        worker_queues_[best_id].push_back(task);
+                        InsertTask(worker_queues_[best_id], task);
                         auto& ws = worker_stats_[best_id];
                         ws.queue_len = worker_queues_[best_id].size();
                         
@@ -391,27 +547,24 @@ void RequestProcessor::HandleTeamRequest(const mini2::Request& request) {
                                   ", queue=" + std::to_string(ws.queue_len) + ")");
                     } else {
                         // No healthy worker, fallback to team queue
-                        team_task_queue_.push_back(task);
+                        InsertTask(team_task_queue_, task);
                     }
                 }
-                
-                size_t assigned_count = 0;
-                for (const auto& [worker_id, queue] : worker_queues_) {
-                    assigned_count += queue.size();
-                }
             }
+            NotifyDispatchWaiters();
             
             LOG_INFO(node_id_, "RequestProcessor",
                      "HandleTeamRequest: created and assigned tasks for request_id=" + request.request_id() + 
                      " (total_rows=" + std::to_string(total_rows) + ")");
             
-            // Wait for workers to pull tasks and send results (10 second timeout)
+            // Wait for every task to complete (10 second timeout). Completion is counted
+            // per chunk so payloads that went straight to the gateway count as well.
             size_t expected_results = num_tasks;
             std::unique_lock<std::mutex> lock(results_mutex_);
             bool got_results = results_cv_.wait_for(lock, kTeamLeaderWaitTimeoutMs, 
                 [this, &request, expected_results]() {
-                    return pending_results_.count(request.request_id()) && 
-                           pending_results_[request.request_id()].size() >= expected_results;
+                    auto it = completed_chunks_.find(request.request_id());
+                    return it != completed_chunks_.end() && it->second.size() >= expected_results;
                 });
             
             if (!got_results) {
@@ -445,21 +598,36 @@ void RequestProcessor::HandleTeamRequest(const mini2::Request& request) {
         std::lock_guard<std::mutex> lock(results_mutex_);
         auto& results = pending_results_[request.request_id()];
         for (const auto& result : results) {
-            ClientContext ctx;
-            mini2::HeartbeatAck ack;
-            Status status = leader_stub_->PushWorkerResult(&ctx, result, &ack);
+            Status status = PushResult(channels_.Bulk(leader_address_), *result);
             if (status.ok()) {
                 LOG_DEBUG(node_id_, "TeamLeader", 
-                          "Sent part " + std::to_string(result.part_index()) + " to leader");
+                          "Sent part " + std::to_string(result->part_index()) + " to leader");
             } else {
                 LOG_ERROR(node_id_, "TeamLeader", 
                           "Failed to send result: " + status.error_message());
             }
         }
-        pending_results_.erase(request.request_id());
     } else {
         LOG_WARN(node_id_, "TeamLeader", "No leader stub available to send results");
     }
+    
+    {
+        std::lock_guard<std::mutex> lock(results_mutex_);
+        pending_results_.erase(request.request_id());
+        completed_chunks_.erase(request.request_id());
+        part_deliveries_.erase(request.request_id());
+        MarkRequestFinished(request.request_id());
+    }
+    ForgetRequestTasks(request.request_id());
+}
+
+bool RequestProcessor::ConsumeTeamRequestStatus(const std::string& request_id) {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    auto it = team_request_status_.find(request_id);
+    if (it == team_request_status_.end()) return true;
+    bool success = it->second.success;
+    team_request_status_.erase(it);
+    return success;
 }
 
 int RequestProcessor::ForwardToWorkers(const mini2::Request& req) {
@@ -488,14 +656,15 @@ int RequestProcessor::ForwardToWorkers(const mini2::Request& req) {
 void RequestProcessor::HandleWorkerRequest(const mini2::Request& request) {
     std::cout << "[Worker " << node_id_ << "] request: " << request.request_id() << std::endl;
 
-    // Generate result and send back to team leader
+    // Generate result and send back to team leader, which owns the part
     auto result = GenerateWorkerResult(request);
+    result.clear_origin();
     
     // Send result back to team leader via PushWorkerResult
     if (leader_stub_) {
         ClientContext ctx;
         mini2::HeartbeatAck ack;
-        Status status = leader_stub_->PushWorkerResult(&ctx, result, &ack);
+        Status status = channels_.Bulk(leader_address_)->PushWorkerResult(&ctx, result, &ack);
         if (status.ok()) {
             std::cout << "[Worker " << node_id_ << "] Sent result to team leader" << std::endl;
         } else {
@@ -552,6 +721,8 @@ mini2::WorkerResult RequestProcessor::ProcessRealData(std::shared_ptr<DataProces
     mini2::WorkerResult result;
     result.set_request_id(req.request_id());
     result.set_part_index(start_idx / count); // Simple part index calculation
+    result.set_origin(node_id_);     // parts of both teams are numbered from 0
+    result.set_worker_id(node_id_);
     
     // Get data chunk
     auto chunk = processor->GetChunk(start_idx, count);
@@ -561,9 +732,9 @@ mini2::WorkerResult RequestProcessor::ProcessRealData(std::shared_ptr<DataProces
     std::string processed = processor->ProcessChunk(chunk, filter_param);
     
     // Set payload
-    result.set_payload(processed);
+    result.set_payload(std::move(processed));
     
-    std::cout << "[" << node_id_ << "] generated " << processed.size() 
+    std::cout << "[" << node_id_ << "] generated " << result.payload().size() 
               << " bytes for part " << result.part_index() << std::endl;
     
     return result;
@@ -588,6 +759,9 @@ mini2::WorkerResult RequestProcessor::ProcessTask(const mini2::Task& task, doubl
     mini2::WorkerResult result;
     result.set_request_id(task.request_id());
     result.set_part_index(task.chunk_id());
+    result.set_origin(task.origin());
+    result.set_worker_id(node_id_);
+    result.set_attempt(task.attempt());
     
     if (proc) {
         // Get data chunk
@@ -595,10 +769,10 @@ mini2::WorkerResult RequestProcessor::ProcessTask(const mini2::Task& task, doubl
         
         // Process chunk
         std::string processed = proc->ProcessChunk(chunk, "");
-        result.set_payload(processed);
+        result.set_payload(std::move(processed));
         
         LOG_DEBUG(node_id_, "Worker", 
-                  "Generated " + std::to_string(processed.size()) + " bytes for task " + 
+                  "Generated " + std::to_string(result.payload().size()) + " bytes for task " + 
                   task.request_id() + "." + std::to_string(task.chunk_id()));
     } else {
         LOG_WARN(node_id_, "Worker", "No dataset loaded for task processing");
@@ -612,6 +786,109 @@ mini2::WorkerResult RequestProcessor::ProcessTask(const mini2::Task& task, doubl
 
 
 
+bool RequestProcessor::DeliverTaskResult(const mini2::Task& task, const mini2::WorkerResult& result) {
+    if (!leader_stub_) {
+        LOG_ERROR(node_id_, "Worker", "No team leader stub to deliver task result");
+        return false;
+    }
+    
+    // Direct path: payload goes straight to the gateway, team leader only gets a notice
+    if (!task.result_sink().empty()) {
+        Status status = PushResult(channels_.Bulk(task.result_sink()), result);
+        if (status.ok()) {
+            // Sent once per task: notice and ack live on a stack arena, no malloc for them
+            InlineArena<1024> arena;
+            auto* notice = google::protobuf::Arena::CreateMessage<mini2::TaskComplete>(arena.get());
+            notice->set_request_id(task.request_id());
+            notice->set_chunk_id(task.chunk_id());
+            notice->set_worker_id(node_id_);
+            notice->set_payload_bytes(result.payload().size());
+            notice->set_origin(task.origin());
+            
+            ClientContext notice_ctx;
+            auto* notice_ack = google::protobuf::Arena::CreateMessage<mini2::HeartbeatAck>(arena.get());
+            status = leader_stub_->ReportTaskComplete(&notice_ctx, *notice, notice_ack);
+            if (!status.ok()) {
+                LOG_ERROR(node_id_, "Worker", 
+                          "Failed to report completion of " + task.request_id() + "." +
+                          std::to_string(task.chunk_id()) + ": " + status.error_message());
+            }
+            return status.ok();
+        }
+        // Frames the gateway already took are dropped there when the relay sends them again
+        LOG_WARN(node_id_, "Worker", 
+                 "Direct push to " + task.result_sink() + " failed (" + status.error_message() +
+                 "); falling back to team leader");
+    }
+    
+    // Relay path: whole result goes to the team leader
+    Status status = PushResult(channels_.Bulk(leader_address_), result);
+    if (!status.ok()) {
+        LOG_ERROR(node_id_, "Worker", "Failed to push result: " + status.error_message());
+    }
+    return status.ok();
+}
+
+Status RequestProcessor::PushResult(mini2::TeamIngress::Stub* stub, const mini2::WorkerResult& result) {
+    const std::string& payload = result.payload();
+    
+    // Small results (and already-framed ones) go as a single unary message
+    if (upload_frame_bytes_ == 0 || payload.size() <= upload_frame_bytes_ || result.frame_count() > 0) {
+        ClientContext ctx;
+        mini2::HeartbeatAck ack;
+        return stub->PushWorkerResult(&ctx, result, &ack);
+    }
+    
+    // Large results are streamed as fixed-size frames so neither side needs
+    // a single message the size of the whole payload
+    const uint64_t frame_count = (payload.size() + upload_frame_bytes_ - 1) / upload_frame_bytes_;
+    ClientContext ctx;
+    mini2::HeartbeatAck ack;
+    auto writer = stub->UploadWorkerResult(&ctx, &ack);
+    
+    mini2::WorkerResult frame;
+    frame.set_request_id(result.request_id());
+    frame.set_part_index(result.part_index());
+    frame.set_origin(result.origin());
+    frame.set_worker_id(result.worker_id());
+    frame.set_attempt(result.attempt());
+    frame.set_frame_count(static_cast<uint32_t>(frame_count));
+    
+    for (uint64_t i = 0; i < frame_count; ++i) {
+        const size_t offset = i * upload_frame_bytes_;
+        const size_t len = std::min<size_t>(upload_frame_bytes_, payload.size() - offset);
+        frame.set_frame_index(static_cast<uint32_t>(i));
+        frame.set_payload(payload.data() + offset, len);
+        if (!writer->Write(frame)) {
+            break;  // stream broken; Finish() below reports why
+        }
+    }
+    writer->WritesDone();
+    Status status = writer->Finish();
+    
+    LOG_DEBUG(node_id_, "Upload", 
+              "Streamed part " + std::to_string(result.part_index()) + " of " + result.request_id() +
+              " as " + std::to_string(frame_count) + " frame(s) (" + 
+              std::to_string(payload.size()) + " bytes)");
+    return status;
+}
+
+std::string RequestProcessor::GetPeerAddress(const std::string& team_leader_id) const {
+    auto it = peer_team_leaders_.find(team_leader_id);
+    return it == peer_team_leaders_.end() ? std::string() : it->second;
+}
+
+mini2::TeamIngress::Stub* RequestProcessor::GetPeerStub(const std::string& team_leader_id) {
+    auto it = peer_stubs_.find(GetPeerAddress(team_leader_id));
+    return it == peer_stubs_.end() ? nullptr : it->second;
+}
+
+bool RequestProcessor::IsForeignOrigin(const std::string& origin) const {
+    // Only a peer team owns work we hold for it; on the gateway every result is
+    // tagged with the team leader it came from and is ours all the same
+    return !origin.empty() && origin != node_id_ && peer_team_leaders_.count(origin) > 0;
+}
+
 grpc::ChannelArguments RequestProcessor::MakeLargeMessageArgs() {
     grpc::ChannelArguments args;
     args.SetMaxReceiveMessageSize(kMaxGrpcMessageSize);
@@ -620,16 +897,17 @@ grpc::ChannelArguments RequestProcessor::MakeLargeMessageArgs() {
 }
 
 void RequestProcessor::RegisterPeer(const std::string& addr,
-                                    std::map<std::string, std::unique_ptr<mini2::TeamIngress::Stub>>& target,
+                                    std::map<std::string, mini2::TeamIngress::Stub*>& target,
                                     const char* label) {
-    auto channel = grpc::CreateCustomChannel(addr, grpc::InsecureChannelCredentials(), MakeLargeMessageArgs());
+    channels_.Register(addr);  // opens and starts connecting every lane to addr
+    auto channel = channels_.ControlChannel(addr);
     
     // Check initial connectivity
     auto state = channel->GetState(true);  // true = try to connect
     std::string state_str = (state == GRPC_CHANNEL_READY) ? "READY" : 
                            (state == GRPC_CHANNEL_CONNECTING) ? "CONNECTING" : "IDLE";
     
-    target[addr] = mini2::TeamIngress::NewStub(channel);
+    target[addr] = channels_.Control(addr);
     if (label) {
         std::cout << "[RequestProcessor] Registered " << label << ": " << addr 
                   << " (state=" << state_str << ")" << std::endl;
@@ -663,7 +941,7 @@ void RequestProcessor::ProcessLocally(std::shared_ptr<DataProcessor> processor,
             mini2::WorkerResult result = ProcessRealData(processor, request, start_idx, count);
             
             // Store result locally
-            ReceiveWorkerResult(result);
+            ReceiveWorkerResult(std::move(result));
         }
     }
 }
@@ -672,18 +950,157 @@ void RequestProcessor::ProcessLocally(std::shared_ptr<DataProcessor> processor,
 // Team Leaders: Result Collection
 // ============================================================================
 
-void RequestProcessor::ReceiveWorkerResult(const mini2::WorkerResult& result) {
-    std::lock_guard<std::mutex> lock(results_mutex_);
-    pending_results_[result.request_id()].push_back(result);
+void RequestProcessor::ReceiveWorkerResult(mini2::WorkerResult result) {
+    // A framed part is complete once its last frame is in (frames of one part
+    // arrive in order on a single upload stream)
+    const bool last_frame = result.frame_count() == 0 ||
+                            result.frame_index() + 1 >= result.frame_count();
+    
+    // Result of a task we stole from a peer team: the peer owns the request bookkeeping
+    if (IsForeignOrigin(result.origin())) {
+        const std::string peer_addr = GetPeerAddress(result.origin());
+        Status status = !peer_addr.empty() ? PushResult(channels_.Bulk(peer_addr), result)
+                                           : Status(grpc::StatusCode::NOT_FOUND, "unknown origin");
+        if (!status.ok()) {
+            LOG_WARN(node_id_, "TeamLeader", 
+                     "Failed to relay result " + result.request_id() + " part=" +
+                     std::to_string(result.part_index()) + " to " + result.origin() + ": " +
+                     status.error_message());
+        }
+        if (last_frame) {
+            OnTaskFinished(result.request_id(), result.origin(), result.part_index());
+        }
+        return;
+    }
+    // Header fields outlive the move of `result` into pending_results_
+    const std::string request_id = result.request_id();
+    const std::string origin = result.origin();
+    const uint32_t part_index = result.part_index();
+    Result stored;
+    const ResultListener* listener = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(results_mutex_);
+        if (!AcceptResult(result)) {
+            LOG_DEBUG(node_id_, "TeamLeader", 
+                      "Dropping duplicate result " + result.request_id() + " part=" +
+                      std::to_string(result.part_index()) + " from " + result.worker_id());
+            return;
+        }
+        
+        if (last_frame) {
+            completed_chunks_[result.request_id()].insert(result.part_index());
+        }
+        
+        std::cout << "[TeamLeader " << node_id_ << "] Received worker result for: " 
+                  << result.request_id() << " part=" << result.part_index();
+        if (result.frame_count() > 0) {
+            std::cout << " frame=" << result.frame_index() + 1 << "/" << result.frame_count();
+        }
+        std::cout << std::endl;
+        
+        // Moved, not copied: this is the only place the payload is stored
+        stored = std::make_shared<const mini2::WorkerResult>(std::move(result));
+        pending_results_[request_id].push_back(stored);
+        
+        auto slot = result_listeners_.find(request_id);
+        if (slot != result_listeners_.end()) {
+            listener = slot->second.listener;
+            slot->second.busy++;
+        }
+        
+        // Notify waiting threads that a result arrived
+        results_cv_.notify_all();
+    }
     
-    std::cout << "[TeamLeader " << node_id_ << "] Received worker result for: " 
-              << result.request_id() << " part=" << result.part_index() << std::endl;
+    if (listener) {
+        listener->on_result(stored);
+        std::lock_guard<std::mutex> lock(results_mutex_);
+        result_listeners_[request_id].busy--;
+        results_cv_.notify_all();
+    }
     
-    // Notify waiting threads that a result arrived
-    results_cv_.notify_all();
+    if (last_frame) {
+        OnTaskFinished(request_id, origin, part_index);
+    }
 }
 
+bool RequestProcessor::AcceptResult(const mini2::WorkerResult& result) {
+    // Called with results_mutex_ already locked
+    if (finished_requests_.count(result.request_id())) {
+        return false;  // request already answered; late backup copy
+    }
+    
+    PartDelivery& delivery =
+        part_deliveries_[result.request_id()][{result.origin(), result.part_index()}];
+    if (delivery.complete) {
+        return false;
+    }
+    if (delivery.worker_id.empty() || result.attempt() > delivery.attempt) {
+        // First deliverer wins; a re-run after the owner's lease was lost takes over and,
+        // producing the same frames, continues at the first one still missing
+        delivery.worker_id = result.worker_id();
+        delivery.attempt = result.attempt();
+    } else if (delivery.worker_id != result.worker_id() || result.attempt() < delivery.attempt) {
+        return false;
+    }
+    if (result.frame_count() == 0) {
+        if (delivery.next_frame > 0) return false;  // part is being delivered in frames
+        delivery.complete = true;
+        return true;
+    }
+    if (result.frame_index() != delivery.next_frame) {
+        return false;  // already stored, or out of order
+    }
+    delivery.next_frame++;
+    if (delivery.next_frame >= result.frame_count()) {
+        delivery.complete = true;
+    }
+    return true;
+}
 
+void RequestProcessor::MarkRequestFinished(const std::string& request_id) {
+    // Called with results_mutex_ already locked
+    constexpr size_t kMaxRememberedRequests = 1024;
+    if (finished_requests_.insert(request_id).second) {
+        finished_requests_order_.push_back(request_id);
+        if (finished_requests_order_.size() > kMaxRememberedRequests) {
+            finished_requests_.erase(finished_requests_order_.front());
+            finished_requests_order_.pop_front();
+        }
+    }
+}
+
+void RequestProcessor::ReceiveTaskComplete(const mini2::TaskComplete& notice) {
+    if (IsForeignOrigin(notice.origin())) {
+        mini2::TeamIngress::Stub* peer = GetPeerStub(notice.origin());
+        if (peer) {
+            ClientContext ctx;
+            mini2::HeartbeatAck ack;
+            Status status = peer->ReportTaskComplete(&ctx, notice, &ack);
+            if (!status.ok()) {
+                LOG_WARN(node_id_, "TeamLeader", 
+                         "Failed to relay completion of " + notice.request_id() + "." +
+                         std::to_string(notice.chunk_id()) + " to " + notice.origin() + ": " +
+                         status.error_message());
+            }
+        }
+        OnTaskFinished(notice.request_id(), notice.origin(), notice.chunk_id());
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(results_mutex_);
+        completed_chunks_[notice.request_id()].insert(notice.chunk_id());
+        
+        LOG_DEBUG(node_id_, "TeamLeader", 
+                  "Task " + notice.request_id() + "." + std::to_string(notice.chunk_id()) +
+                  " delivered to gateway by " + notice.worker_id() +
+                  " (" + std::to_string(notice.payload_bytes()) + " bytes)");
+        
+        results_cv_.notify_all();
+    }
+    OnTaskFinished(notice.request_id(), notice.origin(), notice.chunk_id());
+}
 
 // ============================================================================
 // Status and Control
@@ -741,6 +1158,7 @@ void RequestProcessor::InitiateShutdown(int delay_seconds) {
               << delay_seconds << " seconds..." << std::endl;
     
     shutting_down_ = true;
+    NotifyDispatchWaiters();  // release StreamTasks handlers
     
     // Allow pending work to complete
     if (delay_seconds > 0) {
@@ -760,7 +1178,8 @@ double RequestProcessor::ComputeWorkerRank(const WorkerStats& ws) const {
          - gamma * ws.avg_task_ms;
 }
 
-void RequestProcessor::UpdateWorkerHeartbeat(const std::string& worker_id, double recent_task_ms, uint32_t queue_len) {
+void RequestProcessor::UpdateWorkerHeartbeat(const std::string& worker_id, double recent_task_ms,
+                                             double recent_rows_per_sec, uint32_t queue_len) {
     std::lock_guard<std::mutex> lock(task_mutex_);
     
     auto it = worker_stats_.find(worker_id);
@@ -783,9 +1202,17 @@ void RequestProcessor::UpdateWorkerHeartbeat(const std::string& worker_id, doubl
         ws.avg_task_ms = 0.8 * ws.avg_task_ms + 0.2 * recent_task_ms;
     }
     
+    // Same EMA for throughput; first sample seeds the average
+    if (recent_rows_per_sec > 0.0) {
+        ws.rows_per_sec = (ws.rows_per_sec > 0.0)
+                              ? 0.8 * ws.rows_per_sec + 0.2 * recent_rows_per_sec
+                              : recent_rows_per_sec;
+    }
+    
     LOG_DEBUG(node_id_, "Heartbeat", 
               "Updated stats for " + worker_id + " (healthy=" + std::to_string(ws.healthy) + 
               "): avg_ms=" + std::to_string(ws.avg_task_ms) + 
+              ", rows/s=" + std::to_string(ws.rows_per_sec) + 
               ", queue=" + std::to_string(ws.queue_len));
 }
 
@@ -815,6 +1242,27 @@ void RequestProcessor::MaintenanceTick() {
         }
     }
     
+    // Expire task leases: re-queue tasks whose every attempt ran out of time
+    for (auto it = in_flight_.begin(); it != in_flight_.end(); ) {
+        auto& attempts = it->second.attempts;
+        for (auto a = attempts.begin(); a != attempts.end(); ) {
+            if (a->lease_deadline <= now) {
+                LOG_WARN(node_id_, "Maintenance", 
+                         "Lease expired for task " + std::get<0>(it->first) + "." + 
+                         std::to_string(std::get<2>(it->first)) + " on worker " + a->worker_id);
+                a = attempts.erase(a);
+            } else {
+                ++a;
+            }
+        }
+        if (attempts.empty()) {
+            RequeueTask(it->second.task);
+            it = in_flight_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
     // Check for overloaded workers
     for (const auto& [worker_id, worker_queue] : worker_queues_) {
         if (worker_queue.size() > MAX_QUEUE_PER_WORKER) {
@@ -860,35 +1308,47 @@ mini2::Task RequestProcessor::RequestTaskForWorker(const std::string& worker_id)
         return mini2::Task(); // empty task
     }
     
-    // 1. Check worker's own queue first
+    // 1. Check worker's own queue first, unless the team queue holds more urgent work
     auto& worker_queue = worker_queues_[worker_id];
-    if (!worker_queue.empty()) {
+    const bool team_first = !team_task_queue_.empty() &&
+        (worker_queue.empty() ||
+         RunsBefore(ScheduleKeyOf(team_task_queue_.front()), ScheduleKeyOf(worker_queue.front())));
+    if (!worker_queue.empty() && !team_first) {
         mini2::Task task = worker_queue.front();
         worker_queue.pop_front();
         ws_it->second.queue_len = worker_queue.size();
+        RecordDispatch(worker_id, task);
         LOG_DEBUG(node_id_, "RequestProcessor",
                   "Assigning task " + task.request_id() + "." + std::to_string(task.chunk_id()) +
                   " to worker " + worker_id + " from OWN_QUEUE");
         return task;
     }
     
-    // 2. Try to steal from other workers
+    // 2. Check team task queue
+    if (!team_task_queue_.empty()) {
+        mini2::Task task = team_task_queue_.front();
+        team_task_queue_.pop_front();
+        RecordDispatch(worker_id, task);
+        LOG_DEBUG(node_id_, "RequestProcessor",
+                  "Assigning task " + task.request_id() + "." + std::to_string(task.chunk_id()) +
+                  " to worker " + worker_id + " from TEAM_QUEUE");
+        return task;
+    }
+    
+    // 3. Try to steal from other workers
     mini2::Task stolen_task;
     if (TryStealTask(worker_id, stolen_task)) {
+        RecordDispatch(worker_id, stolen_task);
         LOG_DEBUG(node_id_, "RequestProcessor",
                   "Assigning task " + stolen_task.request_id() + "." + std::to_string(stolen_task.chunk_id()) +
                   " to worker " + worker_id + " via STEAL");
         return stolen_task;
     }
     
-    // 3. Check team task queue
-    if (!team_task_queue_.empty()) {
-        mini2::Task task = team_task_queue_.front();
-        team_task_queue_.pop_front();
-        LOG_DEBUG(node_id_, "RequestProcessor",
-                  "Assigning task " + task.request_id() + "." + std::to_string(task.chunk_id()) +
-                  " to worker " + worker_id + " from TEAM_QUEUE");
-        return task;
+    // 4. Nothing queued: back up a straggling task
+    mini2::Task backup_task;
+    if (TrySpeculativeTask(worker_id, backup_task)) {
+        return backup_task;
     }
     
     // No work available
@@ -896,6 +1356,27 @@ mini2::Task RequestProcessor::RequestTaskForWorker(const std::string& worker_id)
     return mini2::Task(); // empty task
 }
 
+uint64_t RequestProcessor::DispatchSequence() const {
+    std::lock_guard<std::mutex> lock(dispatch_mutex_);
+    return dispatch_seq_;
+}
+
+void RequestProcessor::NotifyDispatchWaiters() {
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex_);
+        dispatch_seq_++;
+    }
+    dispatch_cv_.notify_all();
+}
+
+void RequestProcessor::WaitForDispatchChange(uint64_t seen_sequence, std::chrono::milliseconds timeout) {
+    // The timeout bounds how long speculation and worker recovery go unnoticed
+    std::unique_lock<std::mutex> lock(dispatch_mutex_);
+    dispatch_cv_.wait_for(lock, timeout, [&]() {
+        return dispatch_seq_ != seen_sequence || shutting_down_.load();
+    });
+}
+
 void RequestProcessor::EnsureWorkerRegistered(const std::string& worker_id) {
     // Only relevant for team leaders
     if (node_id_ != "B" && node_id_ != "E") return;
@@ -958,11 +1439,342 @@ bool RequestProcessor::TryStealTask(const std::string& thief_id, mini2::Task& ou
     return true;
 }
 
+std::vector<mini2::Task> RequestProcessor::GiveTasksToPeer(const mini2::StealRequest& request) {
+    std::vector<mini2::Task> given;
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    if (!cross_steal_.enabled) return given;
+    
+    // Only our own queued tasks count; re-giving stolen ones would bounce them around
+    size_t healthy = 0;
+    size_t queued = 0;
+    for (const auto& [id, ws] : worker_stats_) {
+        if (ws.healthy) healthy++;
+    }
+    auto own = [this](const mini2::Task& t) { return !IsForeignOrigin(t.origin()); };
+    for (const auto& [id, queue] : worker_queues_) {
+        queued += std::count_if(queue.begin(), queue.end(), own);
+    }
+    queued += std::count_if(team_task_queue_.begin(), team_task_queue_.end(), own);
+    
+    const size_t keep = static_cast<size_t>(cross_steal_.watermark_per_worker) * std::max<size_t>(1, healthy);
+    if (queued <= keep) return given;
+    
+    size_t want = std::min<size_t>(queued - keep, cross_steal_.max_batch);
+    if (request.max_tasks() > 0) want = std::min<size_t>(want, request.max_tasks());
+    
+    // Take from the tail of the longest queue: those tasks would start last here
+    while (given.size() < want) {
+        std::deque<mini2::Task>* longest = team_task_queue_.empty() ? nullptr : &team_task_queue_;
+        for (auto& [id, queue] : worker_queues_) {
+            if (!longest || queue.size() > longest->size()) longest = &queue;
+        }
+        if (!longest || longest->empty()) break;
+        
+        auto rit = std::find_if(longest->rbegin(), longest->rend(), own);
+        if (rit == longest->rend()) break;
+        given.push_back(*rit);
+        longest->erase(std::next(rit).base());
+        
+        // Lease it under the thief so it is re-run here if the thief never reports back;
+        // capped like worker leases, so that happens before our own wait runs out
+        RecordDispatch("peer:" + request.thief(), given.back());
+    }
+    for (auto& [id, queue] : worker_queues_) {
+        worker_stats_[id].queue_len = queue.size();
+    }
+    
+    if (!given.empty()) {
+        LOG_INFO(node_id_, "TeamLeader", 
+                 "Gave " + std::to_string(given.size()) + " task(s) to peer " + request.thief() +
+                 " (queued=" + std::to_string(queued) + ", watermark=" + std::to_string(keep) + ")");
+    }
+    return given;
+}
+
+void RequestProcessor::StealFromPeers() {
+    auto now = std::chrono::steady_clock::now();
+    uint32_t idle_workers = 0;
+    {
+        std::lock_guard<std::mutex> lock(task_mutex_);
+        if (!cross_steal_.enabled || peer_team_leaders_.empty() || now < next_steal_attempt_) return;
+        
+        // Only when nothing is queued here and some healthy worker holds no task
+        if (!team_task_queue_.empty()) return;
+        for (const auto& [id, queue] : worker_queues_) {
+            if (!queue.empty()) return;
+        }
+        std::set<std::string> busy;
+        for (const auto& [key, entry] : in_flight_) {
+            for (const auto& attempt : entry.attempts) busy.insert(attempt.worker_id);
+        }
+        for (const auto& [id, ws] : worker_stats_) {
+            if (ws.healthy && !busy.count(id)) idle_workers++;
+        }
+        if (idle_workers == 0) return;
+    }
+    
+    size_t stolen = 0;
+    for (const auto& [peer_id, addr] : peer_team_leaders_) {
+        mini2::StealRequest req;
+        req.set_thief(node_id_);
+        req.set_idle_workers(idle_workers);
+        req.set_max_tasks(idle_workers * std::max<uint32_t>(1, cross_steal_.watermark_per_worker));
+        mini2::StealResponse resp;
+        ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(500));
+        Status status = GetPeerStub(peer_id)->StealTasks(&ctx, req, &resp);
+        if (!status.ok() || resp.tasks_size() == 0) continue;
+        
+        {
+            std::lock_guard<std::mutex> lock(task_mutex_);
+            for (const auto& task : resp.tasks()) {
+                InsertTask(team_task_queue_, task);
+            }
+        }
+        stolen += resp.tasks_size();
+        LOG_INFO(node_id_, "TeamLeader", 
+                 "Stole " + std::to_string(resp.tasks_size()) + " task(s) from peer " + peer_id +
+                 " for " + std::to_string(idle_workers) + " idle worker(s)");
+        break;
+    }
+    
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    if (stolen > 0) {
+        steal_backoff_ = 1;
+    } else {
+        steal_backoff_ = std::min<uint32_t>(steal_backoff_ * 2, 10);
+    }
+    next_steal_attempt_ = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(cross_steal_.interval_ms) * steal_backoff_;
+    if (stolen > 0) {
+        NotifyDispatchWaiters();
+    }
+}
+
+void RequestProcessor::RecordDispatch(const std::string& worker_id, const mini2::Task& task) {
+    // Called with task_mutex_ already locked
+    InFlightTask& entry = in_flight_[KeyOf(task)];
+    if (entry.attempts.empty()) {
+        entry.task = task;
+    }
+    entry.attempts.push_back(LeaseAttempt(worker_id, task));
+}
+
+double RequestProcessor::ExpectedTaskMs(const std::string& worker_id, const mini2::Task& task) const {
+    // Called with task_mutex_ already locked
+    double expected_ms = static_cast<double>(kTaskLeaseDefaultMs.count()) / kTaskLeaseFactor;
+    auto it = worker_stats_.find(worker_id);
+    if (it != worker_stats_.end()) {
+        if (it->second.rows_per_sec > 0.0) {
+            expected_ms = task.num_rows() * 1000.0 / it->second.rows_per_sec;
+        } else if (it->second.avg_task_ms > 0.0) {
+            expected_ms = it->second.avg_task_ms;
+        }
+    } else {
+        // A peer team ("peer:<id>") has no stats here: judge it by our slowest measured
+        // worker, the peer's workers run the same code on the same data
+        double slowest_rate = 0.0;
+        for (const auto& [id, ws] : worker_stats_) {
+            if (ws.healthy && ws.rows_per_sec > 0.0 &&
+                (slowest_rate == 0.0 || ws.rows_per_sec < slowest_rate)) {
+                slowest_rate = ws.rows_per_sec;
+            }
+        }
+        if (slowest_rate > 0.0) {
+            expected_ms = task.num_rows() * 1000.0 / slowest_rate;
+        }
+    }
+    return expected_ms;
+}
+
+RequestProcessor::TaskAttempt RequestProcessor::LeaseAttempt(const std::string& worker_id,
+                                                             const mini2::Task& task) const {
+    // Called with task_mutex_ already locked
+    const auto now = std::chrono::steady_clock::now();
+    
+    // Tasks handed to this worker earlier and not finished sit ahead of this one in its
+    // stream window and prefetch queue; the lease runs from when they should be done.
+    // A peer team spreads its tasks over its own workers, so nothing queues there.
+    double queued_ms = 0.0;
+    if (worker_stats_.count(worker_id)) {
+        for (const auto& [key, entry] : in_flight_) {
+            for (const auto& attempt : entry.attempts) {
+                if (attempt.worker_id == worker_id && attempt.expected_done > now) {
+                    queued_ms = std::max(queued_ms,
+                        std::chrono::duration<double, std::milli>(attempt.expected_done - now).count());
+                }
+            }
+        }
+    }
+    
+    TaskLease lease = PlanTaskLease(ExpectedTaskMs(worker_id, task), queued_ms, kTaskLeaseFactor,
+                                    static_cast<double>(kTaskLeaseMinMs.count()),
+                                    static_cast<double>(kTaskLeaseMaxMs.count()));
+    auto at = [now](double ms) {
+        return now + std::chrono::milliseconds(static_cast<long>(ms));
+    };
+    return {worker_id, at(lease.start_ms), at(lease.done_ms), at(lease.deadline_ms)};
+}
+
+RequestProcessor::TaskKey RequestProcessor::KeyOf(const mini2::Task& task) {
+    return TaskKey{task.request_id(), task.origin(), task.chunk_id()};
+}
+
+void RequestProcessor::OnTaskFinished(const std::string& request_id, const std::string& origin,
+                                      uint32_t chunk_id) {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    in_flight_.erase(TaskKey{request_id, origin, chunk_id});
+    
+    // A re-queued copy may still be waiting (lease expired, then the original
+    // holder finished after all); never run it again
+    auto is_done = [&](const mini2::Task& t) {
+        return t.request_id() == request_id && t.origin() == origin && t.chunk_id() == chunk_id;
+    };
+    for (auto& [id, queue] : worker_queues_) {
+        queue.erase(std::remove_if(queue.begin(), queue.end(), is_done), queue.end());
+        worker_stats_[id].queue_len = queue.size();
+    }
+    team_task_queue_.erase(std::remove_if(team_task_queue_.begin(), team_task_queue_.end(), is_done),
+                           team_task_queue_.end());
+}
+
+void RequestProcessor::RequeueTask(const mini2::Task& lost) {
+    // Called with task_mutex_ already locked. Re-executions go ahead of their priority equals.
+    // The new attempt lets the receiver release the lost worker's claim on the part.
+    mini2::Task task = lost;
+    task.set_attempt(lost.attempt() + 1);
+    std::string best_id = ChooseBestWorkerId(task);
+    if (!best_id.empty()) {
+        InsertTask(worker_queues_[best_id], task, true);
+        worker_stats_[best_id].queue_len = worker_queues_[best_id].size();
+    } else {
+        InsertTask(team_task_queue_, task, true);
+    }
+    LOG_INFO(node_id_, "TeamLeader", 
+             "Re-queued task " + task.request_id() + "." + std::to_string(task.chunk_id()) +
+             " to " + (best_id.empty() ? std::string("team queue") : best_id));
+    NotifyDispatchWaiters();
+}
+
+void RequestProcessor::ForgetRequestTasks(const std::string& request_id) {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    // Only our own tasks: tasks stolen from a peer for the same request_id belong to it
+    for (auto it = in_flight_.begin(); it != in_flight_.end(); ) {
+        if (std::get<0>(it->first) == request_id && !IsForeignOrigin(std::get<1>(it->first))) {
+            it = in_flight_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    request_task_totals_.erase(request_id);
+    
+    // Leftovers of a request that timed out must not keep workers busy
+    auto is_stale = [&](const mini2::Task& t) {
+        return t.request_id() == request_id && !IsForeignOrigin(t.origin());
+    };
+    for (auto& [id, queue] : worker_queues_) {
+        queue.erase(std::remove_if(queue.begin(), queue.end(), is_stale), queue.end());
+        worker_stats_[id].queue_len = queue.size();
+    }
+    team_task_queue_.erase(std::remove_if(team_task_queue_.begin(), team_task_queue_.end(), is_stale),
+                           team_task_queue_.end());
+}
+
+bool RequestProcessor::TrySpeculativeTask(const std::string& worker_id, mini2::Task& out_task) {
+    // Called with task_mutex_ already locked
+    if (!speculation_.enabled || in_flight_.empty()) {
+        return false;
+    }
+    
+    // Outstanding (queued + running) tasks per request, to tell when a request is in its tail
+    // (stolen tasks are left to their origin team leader's leases)
+    std::map<std::string, size_t> outstanding;
+    for (const auto& [key, entry] : in_flight_) {
+        if (!IsForeignOrigin(std::get<1>(key))) outstanding[std::get<0>(key)]++;
+    }
+    for (const auto& [id, queue] : worker_queues_) {
+        for (const auto& task : queue) {
+            if (!IsForeignOrigin(task.origin())) outstanding[task.request_id()]++;
+        }
+    }
+    for (const auto& task : team_task_queue_) {
+        if (!IsForeignOrigin(task.origin())) outstanding[task.request_id()]++;
+    }
+    
+    const auto now = std::chrono::steady_clock::now();
+    InFlightTask* best = nullptr;
+    double best_elapsed_ms = -1.0;
+    
+    for (auto& [key, entry] : in_flight_) {
+        if (entry.attempts.empty() || entry.attempts.size() >= speculation_.max_attempts) continue;
+        if (IsForeignOrigin(std::get<1>(key))) continue;
+        
+        bool already_mine = false;
+        for (const auto& attempt : entry.attempts) {
+            if (attempt.worker_id == worker_id) already_mine = true;
+        }
+        if (already_mine) continue;
+        
+        // Measured from the expected start: negative while still queued behind earlier tasks
+        const TaskAttempt& first = entry.attempts.front();
+        double elapsed_ms = std::chrono::duration<double, std::milli>(now - first.started).count();
+        
+        // Straggler: running well past the holder's usual task time
+        bool straggler = false;
+        auto holder_it = worker_stats_.find(first.worker_id);
+        if (holder_it != worker_stats_.end() && holder_it->second.avg_task_ms > 0.0) {
+            straggler = elapsed_ms > speculation_.straggler_factor * holder_it->second.avg_task_ms;
+        }
+        
+        // Tail: most of this request's tasks are already done
+        bool tail = false;
+        auto total_it = request_task_totals_.find(std::get<0>(key));
+        if (total_it != request_task_totals_.end() && total_it->second > 0) {
+            double done_fraction = 1.0 - static_cast<double>(outstanding[std::get<0>(key)]) / total_it->second;
+            tail = done_fraction >= speculation_.after_fraction;
+        }
+        
+        if ((straggler || tail) && elapsed_ms > best_elapsed_ms) {
+            best = &entry;
+            best_elapsed_ms = elapsed_ms;
+        }
+    }
+    
+    if (!best) {
+        return false;
+    }
+    
+    out_task = best->task;
+    LOG_INFO(node_id_, "TeamLeader", 
+             "Speculative backup of task " + out_task.request_id() + "." + 
+             std::to_string(out_task.chunk_id()) + " on " + worker_id + 
+             " (held by " + best->attempts.front().worker_id + " for " + 
+             std::to_string(static_cast<long>(best_elapsed_ms)) + "ms)");
+    best->attempts.push_back(LeaseAttempt(worker_id, out_task));
+    return true;
+}
+
 void RequestProcessor::OnWorkerBecameUnhealthy(const std::string& worker_id) {
     // Called with task_mutex_ already locked
     auto& ws = worker_stats_[worker_id];
     auto& worker_queue = worker_queues_[worker_id];
     size_t num_tasks = worker_queue.size();
+    ws.healthy = false;  // keep ChooseBestWorkerId from picking the dead worker
+    
+    // Tasks the worker was running: drop its lease and re-queue right away
+    // unless another attempt is still alive
+    for (auto it = in_flight_.begin(); it != in_flight_.end(); ) {
+        auto& attempts = it->second.attempts;
+        attempts.erase(std::remove_if(attempts.begin(), attempts.end(),
+                                      [&](const TaskAttempt& a) { return a.worker_id == worker_id; }),
+                       attempts.end());
+        if (attempts.empty()) {
+            RequeueTask(it->second.task);
+            it = in_flight_.erase(it);
+        } else {
+            ++it;
+        }
+    }
     
     if (num_tasks == 0) {
         ws.healthy = false;
@@ -980,43 +1792,58 @@ void RequestProcessor::OnWorkerBecameUnhealthy(const std::string& worker_id) {
         worker_queue.pop_front();
         
         // Try to assign to a healthy worker
-        std::string best_id = ChooseBestWorkerId();
+        std::string best_id = ChooseBestWorkerId(task);
         if (!best_id.empty() && best_id != worker_id) {
-            worker_queues_[best_id].push_back(task);
+            InsertTask(worker_queues_[best_id], task);
             worker_stats_[best_id].queue_len = worker_queues_[best_id].size();
             LOG_DEBUG(node_id_, "TeamLeader", 
                       "Reassigned task " + task.request_id() + "." + std::to_string(task.chunk_id()) + 
                       " from " + worker_id + " to " + best_id);
         } else {
             // No healthy worker available, put in team queue
-            team_task_queue_.push_back(task);
+            InsertTask(team_task_queue_, task);
         }
     }
     
     ws.healthy = false;
     ws.queue_len = 0;
+    NotifyDispatchWaiters();
 }
 
-std::string RequestProcessor::ChooseBestWorkerId() const {
-    // Called with task_mutex_ already locked
-    std::string best_id;
-    double best_score = std::numeric_limits<double>::max();
-    
-    for (const auto& [id, info] : worker_stats_) {
-        if (!info.healthy) continue;
-        
-        // Base score from avg latency; if no latency yet, use a default
-        double latency = (info.avg_task_ms > 0.0) ? info.avg_task_ms : 100.0;
-        
-        // Add a penalty for queue length (factor 50ms per queued task)
-        double score = latency + info.queue_len * 50.0;
-        
-        if (score < best_score) {
-            best_score = score;
-            best_id = id;
+std::string RequestProcessor::ChooseBestWorkerId(const mini2::Task& task) const {
+    // Called with task_mutex_ already locked.
+    // Earliest predicted finish given each worker's backlog and throughput
+    std::vector<WorkerProfile> profiles = BuildWorkerProfiles(ScheduleKeyOf(task));
+    size_t best = PickWorkerForTask(task.num_rows(), profiles);
+    return best < profiles.size() ? profiles[best].id : std::string();
+}
+
+std::vector<WorkerProfile> RequestProcessor::BuildWorkerProfiles(const ScheduleKey& key) const {
+    // Called with task_mutex_ already locked. Queued tasks `key` would overtake are not backlog.
+    std::map<std::string, uint64_t> running_rows;
+    for (const auto& [slot, entry] : in_flight_) {
+        for (const auto& attempt : entry.attempts) {
+            running_rows[attempt.worker_id] += entry.task.num_rows();
         }
     }
     
-    return best_id;
+    std::vector<WorkerProfile> profiles;
+    for (const auto& [id, ws] : worker_stats_) {
+        if (!ws.healthy) continue;
+        WorkerProfile p;
+        p.id = id;
+        p.rows_per_sec = ws.rows_per_sec;
+        p.capacity_score = ws.capacity_score;
+        p.backlog_rows = running_rows[id];
+        auto q = worker_queues_.find(id);
+        if (q != worker_queues_.end()) {
+            for (const auto& task : q->second) {
+                if (!RunsBefore(key, ScheduleKeyOf(task))) p.backlog_rows += task.num_rows();
+            }
+        }
+        p.rank = ComputeWorkerRank(ws);
+        profiles.push_back(p);
+    }
+    return profiles;
 }
 
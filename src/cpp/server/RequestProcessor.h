@@ -3,6 +3,10 @@
 #include <grpcpp/grpcpp.h>
 #include "minitwo.grpc.pb.h"
 #include "DataProcessor.h"
+#include "Scheduler.h"
+#include "Priority.h"
+#include "ChannelPool.h"
+#include "../common/config.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -13,6 +17,9 @@
 #include <condition_variable>
 #include <utility>
 #include <deque>
+#include <functional>
+#include <set>
+#include <tuple>
 
 // Forward declarations
 class RequestProcessor {
@@ -20,24 +27,52 @@ public:
     explicit RequestProcessor(const std::string& node_id);
     ~RequestProcessor();
 
+    // Results are stored once, as received, and shared from there on
+    using Result = std::shared_ptr<const mini2::WorkerResult>;
+    
+    // Hands a running request's results to the gateway while ProcessRequest still waits.
+    // Called outside RequestProcessor's locks; ProcessRequest returns only after the last
+    // call has finished.
+    struct ResultListener {
+        std::function<void(const Result&)> on_result;  // each result as it arrives
+        std::function<void()> on_team_done;            // a team leader answered: its parts are all in
+    };
+    
     // For Process A (Leader)
-    std::vector<mini2::WorkerResult> ProcessRequest(const mini2::Request& request);
+    // `complete` (optional) is set when every requested team answered in time
+    std::vector<Result> ProcessRequest(const mini2::Request& request, bool* complete = nullptr,
+                                       const ResultListener* listener = nullptr);
     
     // For Team Leaders (B, E)
     void HandleTeamRequest(const mini2::Request& request);
+    bool ConsumeTeamRequestStatus(const std::string& request_id);  // true = every task finished
     
     // For Workers (C, D, F)
     void HandleWorkerRequest(const mini2::Request& request);
     mini2::WorkerResult GenerateWorkerResult(const mini2::Request& request);
     mini2::WorkerResult ProcessTask(const mini2::Task& task, double& processing_time_ms);
+    bool DeliverTaskResult(const mini2::Task& task, const mini2::WorkerResult& result);
     
-    // For Team Leaders - collect worker results
-    void ReceiveWorkerResult(const mini2::WorkerResult& result);
+    // For Team Leaders - collect worker results. Takes the result by value so
+    // callers that own it can std::move the payload in without a copy.
+    void ReceiveWorkerResult(mini2::WorkerResult result);
+    void ReceiveTaskComplete(const mini2::TaskComplete& notice);
 
     // Set neighbor connections from config
     void SetTeamLeaders(const std::vector<std::pair<std::string, std::string>>& team_leader_endpoints);
     void SetWorkers(const std::map<std::string, std::pair<std::string, int>>& worker_info); // worker_id -> (addr, capacity_score)
     void SetLeaderAddress(const std::string& leader_address);
+    void SetTaskSizing(const TaskSizingConfig& task_sizing);
+    void SetResultSink(const std::string& gateway_address); // team leaders: workers push payloads here
+    void SetUploadFrameBytes(uint64_t frame_bytes);         // results above this size are streamed
+    void SetSpeculation(const SpeculationConfig& speculation);
+    void SetPeerTeamLeaders(const std::map<std::string, std::string>& peers); // team leader id -> addr
+    void SetCrossTeamSteal(const CrossTeamStealConfig& steal);
+    void SetChannelPool(const ChannelPoolConfig& pool);  // before any peer is registered
+    
+    // Connections to peers: control lane for small RPCs, warmed at startup
+    std::shared_ptr<grpc::Channel> ControlChannel(const std::string& addr);
+    bool WarmUpChannels(std::chrono::milliseconds timeout);
     
     // Real data processing
     void LoadDataset(const std::string& dataset_path);
@@ -49,18 +84,33 @@ public:
     void InitiateShutdown(int delay_seconds = 5);
     bool IsShuttingDown() const { return shutting_down_; }
     void MaintenanceTick();
-    void UpdateWorkerHeartbeat(const std::string& worker_id, double recent_task_ms, uint32_t queue_len);
+    void UpdateWorkerHeartbeat(const std::string& worker_id, double recent_task_ms,
+                               double recent_rows_per_sec, uint32_t queue_len);
     mini2::Task RequestTaskForWorker(const std::string& worker_id);
     void EnsureWorkerRegistered(const std::string& worker_id);
+    
+    // Streaming dispatch: the StreamTasks dispatch thread sleeps until tasks may be queued
+    uint64_t DispatchSequence() const;
+    void NotifyDispatchWaiters();
+    void WaitForDispatchChange(uint64_t seen_sequence, std::chrono::milliseconds timeout);
+    
+    // Cross-team stealing: victim hands out surplus, thief pulls when its workers are idle
+    std::vector<mini2::Task> GiveTasksToPeer(const mini2::StealRequest& request);
+    void StealFromPeers();
 
 private:
     std::string node_id_;
     
-    // gRPC client stubs for forwarding
-    std::map<std::string, std::unique_ptr<mini2::TeamIngress::Stub>> team_leader_stubs_;
+    // gRPC client stubs for forwarding: control lanes owned by channels_; result
+    // payloads go over channels_.Bulk(addr) so they never delay these
+    ChannelPool channels_;
+    std::map<std::string, mini2::TeamIngress::Stub*> team_leader_stubs_;
     std::map<std::string, std::string> team_leader_roles_;
-    std::map<std::string, std::unique_ptr<mini2::TeamIngress::Stub>> worker_stubs_;
-    std::unique_ptr<mini2::TeamIngress::Stub> leader_stub_;
+    std::map<std::string, mini2::TeamIngress::Stub*> worker_stubs_;
+    mini2::TeamIngress::Stub* leader_stub_ = nullptr;
+    std::string leader_address_;
+    std::string result_sink_;  // team leaders: address stamped into Task.result_sink
+    uint64_t upload_frame_bytes_ = 0;  // 0 = always send results as one unary message
     
     // Data processor for real data
     std::shared_ptr<DataProcessor> data_processor_;
@@ -70,7 +120,28 @@ private:
     // Storage for results
     mutable std::mutex results_mutex_;
     std::condition_variable results_cv_;
-    std::map<std::string, std::vector<mini2::WorkerResult>> pending_results_;
+    std::map<std::string, std::vector<Result>> pending_results_;
+    struct ListenerSlot {
+        const ResultListener* listener;
+        int busy = 0;  // on_result calls in progress
+    };
+    std::map<std::string, ListenerSlot> result_listeners_;  // gateway: request_id -> streaming target
+    std::map<std::string, std::set<uint32_t>> completed_chunks_;  // request_id -> finished chunk ids
+    
+    // Duplicate suppression: the first worker to deliver a part owns it, copies from
+    // speculative backups are dropped. Keyed request_id -> (origin, part_index).
+    // Frames are taken strictly in order, so a frame sent again (a worker falling back
+    // to its team leader after a partial direct upload) is dropped as well. A re-run
+    // of the task (higher attempt) takes the part over from a worker that was lost.
+    struct PartDelivery {
+        std::string worker_id;
+        uint32_t attempt = 0;
+        uint32_t next_frame = 0;
+        bool complete = false;
+    };
+    std::map<std::string, std::map<std::pair<std::string, uint32_t>, PartDelivery>> part_deliveries_;
+    std::set<std::string> finished_requests_;           // late results for these are dropped
+    std::deque<std::string> finished_requests_order_;   // bounds finished_requests_
     
     // Track team request success/failure (internal, not in proto)
     struct TeamRequestStatus {
@@ -90,26 +161,74 @@ private:
         std::string addr;
         uint32_t capacity_score = 1;
         double   avg_task_ms    = 0.0;
+        double   rows_per_sec   = 0.0;  // EMA of measured throughput (0 = no history)
         size_t   queue_len      = 0;
         std::chrono::steady_clock::time_point last_heartbeat;
         bool     healthy        = true;
     };
     std::map<std::string, WorkerStats> worker_stats_;               // worker_id -> stats
+    // Both kept in priority/deadline order (InsertTask), FIFO among equals
     std::map<std::string, std::deque<mini2::Task>> worker_queues_;  // worker_id -> tasks
     std::deque<mini2::Task> team_task_queue_;                       // global team queue
+    
+    // Tasks handed out to workers but not finished yet (speculative backups, leases)
+    struct TaskAttempt {
+        std::string worker_id;
+        std::chrono::steady_clock::time_point started;         // expected start, behind the worker's queue
+        std::chrono::steady_clock::time_point expected_done;
+        std::chrono::steady_clock::time_point lease_deadline;  // re-queue if still running by then
+    };
+    struct InFlightTask {
+        mini2::Task task;
+        std::vector<TaskAttempt> attempts;
+    };
+    // (request_id, origin, chunk_id): both teams number chunks of the same request from 0
+    using TaskKey = std::tuple<std::string, std::string, uint32_t>;
+    static TaskKey KeyOf(const mini2::Task& task);
+    std::map<TaskKey, InFlightTask> in_flight_;
+    std::map<std::string, size_t> request_task_totals_;                   // request_id -> tasks created
+    SpeculationConfig speculation_;
     mutable std::mutex task_mutex_;
+    TaskSizingConfig task_sizing_;
+    
+    // Peer team leaders for cross-team stealing and relaying results of stolen tasks
+    std::map<std::string, std::string> peer_team_leaders_;  // id -> addr
+    std::map<std::string, mini2::TeamIngress::Stub*> peer_stubs_;  // addr -> control stub
+    CrossTeamStealConfig cross_steal_;
+    std::chrono::steady_clock::time_point next_steal_attempt_;
+    uint32_t steal_backoff_ = 1;
+    
+    // Bumped whenever dispatchable work may have appeared (lock order: task_mutex_ first)
+    mutable std::mutex dispatch_mutex_;
+    std::condition_variable dispatch_cv_;
+    uint64_t dispatch_seq_ = 0;
     
     // Helper methods
     double ComputeWorkerRank(const WorkerStats& ws) const;
     bool TryStealTask(const std::string& thief_id, mini2::Task& out_task);
+    bool TrySpeculativeTask(const std::string& worker_id, mini2::Task& out_task);
+    void RecordDispatch(const std::string& worker_id, const mini2::Task& task);
+    void OnTaskFinished(const std::string& request_id, const std::string& origin, uint32_t chunk_id);
+    void RequeueTask(const mini2::Task& lost);
+    double ExpectedTaskMs(const std::string& worker_id, const mini2::Task& task) const;
+    TaskAttempt LeaseAttempt(const std::string& worker_id, const mini2::Task& task) const;
+    void ForgetRequestTasks(const std::string& request_id);
+    bool AcceptResult(const mini2::WorkerResult& result);
+    void MarkRequestFinished(const std::string& request_id);
     void OnWorkerBecameUnhealthy(const std::string& worker_id);
-    std::string ChooseBestWorkerId() const;
-    int ForwardToTeamLeaders(const mini2::Request& req, bool need_green, bool need_pink);
+    std::string ChooseBestWorkerId(const mini2::Task& task) const;
+    std::vector<WorkerProfile> BuildWorkerProfiles(const ScheduleKey& key) const;
+    int ForwardToTeamLeaders(const mini2::Request& req, bool need_green, bool need_pink,
+                             int* complete_teams = nullptr, const ResultListener* listener = nullptr);
     int ForwardToWorkers(const mini2::Request& req);
+    std::string GetPeerAddress(const std::string& team_leader_id) const;
+    mini2::TeamIngress::Stub* GetPeerStub(const std::string& team_leader_id);
+    bool IsForeignOrigin(const std::string& origin) const;  // origin is a peer team leader
+    grpc::Status PushResult(mini2::TeamIngress::Stub* stub, const mini2::WorkerResult& result);
     mini2::WorkerResult ProcessRealData(std::shared_ptr<DataProcessor> processor, const mini2::Request& req, size_t start_idx, size_t count);
     static grpc::ChannelArguments MakeLargeMessageArgs();
     void RegisterPeer(const std::string& addr,
-                      std::map<std::string, std::unique_ptr<mini2::TeamIngress::Stub>>& target,
+                      std::map<std::string, mini2::TeamIngress::Stub*>& target,
                       const char* label);
     void LoadDatasetIfNeeded(const mini2::Request& request);
     void ProcessLocally(std::shared_ptr<DataProcessor> processor, const mini2::Request& request, uint32_t partitions);
@@ -0,0 +1,117 @@
+// ResultCache.cpp - LRU cache of gateway results keyed by dataset version and query
+
+#include "ResultCache.h"
+#include "../common/logging.h"
+#include <filesystem>
+#include <sstream>
+#include <system_error>
+
+namespace {
+// Separates the path from the version/query part of a key (never appears in paths)
+constexpr char kKeySeparator = '\x1f';
+}
+
+ResultCache::ResultCache(const std::string& node_id, const ResultCacheConfig& cfg)
+    : node_id_(node_id), cfg_(cfg) {}
+
+std::string ResultCache::MakeKey(const mini2::Request& request) {
+    std::error_code ec;
+    const std::filesystem::path path(request.query());
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec) return "";
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return "";
+    
+    std::ostringstream key;
+    key << request.query() << kKeySeparator
+        << size << ':' << mtime.time_since_epoch().count() << ':'
+        << (request.need_green() ? 'G' : '-') << (request.need_pink() ? 'P' : '-');
+    return key.str();
+}
+
+std::string ResultCache::PathOfKey(const std::string& key) {
+    return key.substr(0, key.find(kKeySeparator));
+}
+
+ResultCache::Results ResultCache::Lookup(const std::string& key) {
+    if (!cfg_.enabled || key.empty()) return nullptr;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    InvalidateOtherVersionsLocked(PathOfKey(key), key);
+    
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    stats_.hits++;
+    return it->second->results;
+}
+
+void ResultCache::Insert(const std::string& key, Results results) {
+    if (!cfg_.enabled || key.empty() || !results) return;
+    
+    uint64_t bytes = 0;
+    for (const auto& r : *results) bytes += r->payload().size();
+    if (bytes > cfg_.max_bytes) {
+        LOG_DEBUG(node_id_, "ResultCache", "Not caching " + std::to_string(bytes) + " bytes (over budget)");
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string path = PathOfKey(key);
+    InvalidateOtherVersionsLocked(path, key);
+    
+    auto existing = index_.find(key);
+    if (existing != index_.end()) {
+        EraseLocked(existing->second);
+    }
+    
+    Entry entry;
+    entry.key = key;
+    entry.dataset_path = path;
+    entry.results = std::move(results);
+    entry.bytes = bytes;
+    lru_.push_front(std::move(entry));
+    index_[key] = lru_.begin();
+    stats_.bytes += bytes;
+    
+    // Evict least recently used entries until within budget
+    while (!lru_.empty() && (stats_.bytes > cfg_.max_bytes ||
+                             (cfg_.max_entries > 0 && lru_.size() > cfg_.max_entries))) {
+        auto victim = std::prev(lru_.end());
+        LOG_DEBUG(node_id_, "ResultCache", "Evicting " + victim->dataset_path + 
+                  " (" + std::to_string(victim->bytes) + " bytes)");
+        EraseLocked(victim);
+        stats_.evictions++;
+    }
+    stats_.entries = lru_.size();
+}
+
+void ResultCache::InvalidateOtherVersionsLocked(const std::string& dataset_path, const std::string& key) {
+    // Called with mutex_ held. Same path, different size/mtime: the file changed
+    const std::string version_prefix = key.substr(0, key.rfind(':'));
+    for (auto it = lru_.begin(); it != lru_.end(); ) {
+        auto next = std::next(it);
+        if (it->dataset_path == dataset_path &&
+            it->key.compare(0, version_prefix.size(), version_prefix) != 0) {
+            LOG_INFO(node_id_, "ResultCache", "Dataset " + dataset_path + " changed; dropping cached results");
+            EraseLocked(it);
+            stats_.invalidations++;
+        }
+        it = next;
+    }
+}
+
+void ResultCache::EraseLocked(std::list<Entry>::iterator it) {
+    stats_.bytes -= it->bytes;
+    index_.erase(it->key);
+    lru_.erase(it);
+    stats_.entries = lru_.size();
+}
+
+ResultCache::Stats ResultCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
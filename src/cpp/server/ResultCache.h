@@ -0,0 +1,58 @@
+#pragma once
+
+#include "minitwo.grpc.pb.h"
+#include "../common/config.h"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Leader-side cache of finished request results (A only).
+// Entries are keyed by dataset path + file size + mtime + query spec, so a rewritten
+// dataset never matches an old entry; older versions of a path are dropped on sight.
+// Eviction is LRU within a byte budget and an entry count limit.
+class ResultCache {
+public:
+    // Each result is shared with the sessions it was streamed to as it arrived
+    using Results = std::shared_ptr<const std::vector<std::shared_ptr<const mini2::WorkerResult>>>;
+
+    ResultCache(const std::string& node_id, const ResultCacheConfig& cfg);
+
+    // Cache key for a request, or "" when it cannot be cached (dataset not stat-able here)
+    static std::string MakeKey(const mini2::Request& request);
+
+    Results Lookup(const std::string& key);
+    void Insert(const std::string& key, Results results);
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t invalidations = 0;
+        uint64_t bytes = 0;
+        size_t entries = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::string dataset_path;
+        Results results;
+        uint64_t bytes = 0;
+    };
+
+    void EraseLocked(std::list<Entry>::iterator it);
+    void InvalidateOtherVersionsLocked(const std::string& dataset_path, const std::string& key);
+    static std::string PathOfKey(const std::string& key);
+
+    std::string node_id_;
+    ResultCacheConfig cfg_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // front = most recently used
+    std::map<std::string, std::list<Entry>::iterator> index_;
+    Stats stats_;
+};
@@ -0,0 +1,160 @@
+// Scheduler.cpp - Cost model for placing team tasks on workers (B, E)
+// Predicted time of a task on a worker = (backlog rows + task rows) / estimated rows/sec
+
+#include "Scheduler.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+// Prior throughput per capacity point before any worker has reported a rate.
+// Only ratios matter for the split; the absolute value only scales predictions.
+constexpr double kPriorRowsPerSecPerCapacity = 100000.0;
+
+double FinishMs(uint64_t rows, double rows_per_sec) {
+    return rows_per_sec > 0.0 ? rows * 1000.0 / rows_per_sec : 0.0;
+}
+}
+
+std::vector<double> EstimateRowsPerSec(const std::vector<WorkerProfile>& workers) {
+    double per_capacity_sum = 0.0;
+    size_t measured = 0;
+    for (const auto& w : workers) {
+        if (w.rows_per_sec > 0.0) {
+            per_capacity_sum += w.rows_per_sec / std::max<uint32_t>(1, w.capacity_score);
+            measured++;
+        }
+    }
+    const double per_capacity = measured > 0 ? per_capacity_sum / measured : kPriorRowsPerSecPerCapacity;
+    
+    std::vector<double> rates;
+    rates.reserve(workers.size());
+    for (const auto& w : workers) {
+        rates.push_back(w.rows_per_sec > 0.0 ? w.rows_per_sec
+                                             : per_capacity * std::max<uint32_t>(1, w.capacity_score));
+    }
+    return rates;
+}
+
+Schedule PlanSchedule(uint64_t total_rows, uint64_t max_task_rows,
+                      const std::vector<WorkerProfile>& workers) {
+    Schedule sched;
+    if (workers.empty() || total_rows == 0) {
+        return sched;
+    }
+    max_task_rows = std::max<uint64_t>(1, max_task_rows);
+    const std::vector<double> rates = EstimateRowsPerSec(workers);
+    
+    // Water-filling: common finish time T with share_i = (T - backlog_i) * rate_i.
+    // Workers whose backlog already runs past T get nothing and are dropped.
+    std::vector<bool> active(workers.size(), true);
+    double finish_s = 0.0;
+    for (size_t round = 0; round < workers.size(); ++round) {
+        double rate_sum = 0.0;
+        double backlog_rows = 0.0;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (!active[i]) continue;
+            rate_sum += rates[i];
+            backlog_rows += static_cast<double>(workers[i].backlog_rows);
+        }
+        finish_s = (static_cast<double>(total_rows) + backlog_rows) / rate_sum;
+        
+        bool dropped = false;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (active[i] && workers[i].backlog_rows / rates[i] >= finish_s) {
+                active[i] = false;
+                dropped = true;
+            }
+        }
+        if (!dropped) break;
+    }
+    
+    std::vector<uint64_t> shares(workers.size(), 0);
+    uint64_t assigned = 0;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (!active[i]) continue;
+        double share = (finish_s - workers[i].backlog_rows / rates[i]) * rates[i];
+        shares[i] = std::min<uint64_t>(total_rows - assigned, static_cast<uint64_t>(std::max(0.0, share)));
+        assigned += shares[i];
+    }
+    
+    // Rounding leftovers go to whichever worker finishes them first
+    std::vector<WorkerProfile> loaded = workers;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        loaded[i].backlog_rows += shares[i];
+    }
+    if (assigned < total_rows) {
+        size_t i = PickWorkerForTask(total_rows - assigned, loaded);
+        shares[i] += total_rows - assigned;
+        loaded[i].backlog_rows += total_rows - assigned;
+    }
+    
+    // Lay shares out by rank, cut each into tasks
+    std::vector<size_t> order(workers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return workers[a].rank > workers[b].rank;
+    });
+    
+    uint64_t start = 0;
+    for (size_t i : order) {
+        uint64_t left = shares[i];
+        while (left > 0) {
+            TaskRange r;
+            r.start_row = start;
+            r.num_rows = std::min(left, max_task_rows);
+            sched.tasks.push_back(r);
+            sched.worker_for_task.push_back(i);
+            start += r.num_rows;
+            left -= r.num_rows;
+        }
+    }
+    
+    sched.finish_ms.resize(workers.size());
+    for (size_t i = 0; i < workers.size(); ++i) {
+        sched.finish_ms[i] = FinishMs(loaded[i].backlog_rows, rates[i]);
+        sched.makespan_ms = std::max(sched.makespan_ms, sched.finish_ms[i]);
+    }
+    return sched;
+}
+
+size_t PickWorkerForTask(uint64_t task_rows, const std::vector<WorkerProfile>& workers) {
+    const std::vector<double> rates = EstimateRowsPerSec(workers);
+    size_t best = workers.size();
+    double best_finish = 0.0;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        double finish = FinishMs(workers[i].backlog_rows + task_rows, rates[i]);
+        if (best == workers.size() || finish < best_finish ||
+            (finish == best_finish && workers[i].rank > workers[best].rank)) {
+            best = i;
+            best_finish = finish;
+        }
+    }
+    return best;
+}
+
+std::vector<double> PredictFinishMs(const std::vector<TaskRange>& tasks,
+                                    const std::vector<size_t>& worker_for_task,
+                                    const std::vector<WorkerProfile>& workers) {
+    const std::vector<double> rates = EstimateRowsPerSec(workers);
+    std::vector<uint64_t> rows(workers.size(), 0);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        rows[i] = workers[i].backlog_rows;
+    }
+    for (size_t t = 0; t < tasks.size() && t < worker_for_task.size(); ++t) {
+        rows[worker_for_task[t]] += tasks[t].num_rows;
+    }
+    std::vector<double> finish(workers.size());
+    for (size_t i = 0; i < workers.size(); ++i) {
+        finish[i] = FinishMs(rows[i], rates[i]);
+    }
+    return finish;
+}
+
+TaskLease PlanTaskLease(double expected_ms, double queued_ms, double factor,
+                        double min_ms, double max_ms) {
+    TaskLease lease;
+    lease.start_ms = std::max(queued_ms, 0.0);
+    lease.done_ms = lease.start_ms + expected_ms;
+    lease.deadline_ms = factor * lease.start_ms + std::min(std::max(factor * expected_ms, min_ms), max_ms);
+    return lease;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "TaskPlanner.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What the team leader knows about one healthy worker when placing tasks
+struct WorkerProfile {
+    std::string id;
+    double   rows_per_sec   = 0.0;  // measured EMA (0 = no history yet)
+    uint32_t capacity_score = 1;
+    uint64_t backlog_rows   = 0;    // rows already queued or running on it
+    double   rank           = 0.0;  // ComputeWorkerRank, breaks ties
+};
+
+// Rows to place on each worker, in the order of PlanSchedule's input
+struct Schedule {
+    std::vector<TaskRange> tasks;        // in row order
+    std::vector<size_t> worker_for_task; // index into the workers vector
+    std::vector<double> finish_ms;       // predicted finish per worker, backlog included
+    double makespan_ms = 0.0;
+};
+
+// Throughput used by the cost model: the measured rate, or capacity_score times the
+// measured rate per capacity point of the other workers, or a capacity-only prior.
+std::vector<double> EstimateRowsPerSec(const std::vector<WorkerProfile>& workers);
+
+// Cost-model placement: rows are split into per-worker shares proportional to
+// estimated throughput so every worker (backlog included) is predicted to finish
+// at the same time, then each share is cut into tasks of at most max_task_rows.
+// Shares are laid out by descending rank so the strongest worker starts at row 0.
+Schedule PlanSchedule(uint64_t total_rows, uint64_t max_task_rows,
+                      const std::vector<WorkerProfile>& workers);
+
+// Earliest-finish-time pick for a single task (re-queues, reassignment).
+// Returns workers.size() when the list is empty.
+size_t PickWorkerForTask(uint64_t task_rows, const std::vector<WorkerProfile>& workers);
+
+// Predicted finish per worker for an explicit assignment (tests, logs)
+std::vector<double> PredictFinishMs(const std::vector<TaskRange>& tasks,
+                                    const std::vector<size_t>& worker_for_task,
+                                    const std::vector<WorkerProfile>& workers);
+
+// Lease for a task handed to a worker, in ms from dispatch. A worker holds up to its
+// stream credit window plus executor prefetch of earlier tasks, so the task starts only
+// once queued_ms of work ahead of it has drained; its own run is leased for factor x
+// expected_ms kept within [min_ms, max_ms], and the queue gets the same slack.
+struct TaskLease {
+    double start_ms    = 0.0;  // expected start
+    double done_ms     = 0.0;  // expected finish, what the next task queues behind
+    double deadline_ms = 0.0;  // re-queue if not finished by then
+};
+TaskLease PlanTaskLease(double expected_ms, double queued_ms, double factor,
+                        double min_ms, double max_ms);
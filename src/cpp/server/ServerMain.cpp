@@ -8,6 +8,8 @@
 #include "../common/logging.h"
 #include "RequestProcessor.h"
 #include "SessionManager.h"
+#include "WorkerExecutor.h"
+#include "TaskStreamClient.h"
 #include <iostream>
 #include <memory>
 #include <csignal>
@@ -80,7 +82,9 @@ int main(int argc, char** argv){
     std::string public_addr = me.host + ":" + std::to_string(me.port);
 
     auto processor = std::make_shared<RequestProcessor>(node_id);
-    auto session_manager = std::make_shared<SessionManager>();    
+    processor->SetUploadFrameBytes(cfg.data_path.upload_frame_bytes);
+    processor->SetChannelPool(cfg.channel_pool);
+    auto session_manager = std::make_shared<SessionManager>(cfg.sessions, cfg.chunk_store);
     if (node_id == "A") {
         std::string addr_B = cfg.nodes["B"].host + ":" + std::to_string(cfg.nodes["B"].port);
         std::string addr_E = cfg.nodes["E"].host + ":" + std::to_string(cfg.nodes["E"].port);
@@ -108,6 +112,18 @@ int main(int argc, char** argv){
         }
 
         processor->SetWorkers(workers);
+        processor->SetTaskSizing(cfg.task_sizing);
+        processor->SetSpeculation(cfg.speculation);
+        processor->SetCrossTeamSteal(cfg.cross_team_steal);
+        
+        // The other team leader: source of surplus tasks and destination of relayed results
+        const std::string peer_id = (node_id == "B") ? "E" : "B";
+        processor->SetPeerTeamLeaders({
+            {peer_id, cfg.nodes[peer_id].host + ":" + std::to_string(cfg.nodes[peer_id].port)}
+        });
+        if (cfg.data_path.direct_to_gateway) {
+            processor->SetResultSink(addr_A);
+        }
 
         // Log configuration
         std::ostringstream oss;
@@ -142,8 +158,12 @@ int main(int argc, char** argv){
     b.SetMaxSendMessageSize(1536 * 1024 * 1024);    // 1.5GB
     
     NodeControlService nodeSvc(processor, node_id);
-    TeamIngressService teamSvc(processor, node_id);
-    ClientGatewayService clientSvc(processor, session_manager);
+    TeamIngressService teamSvc(processor, node_id, cfg.ingress);
+    std::shared_ptr<ResultCache> result_cache;
+    if (node_id == "A" && cfg.result_cache.enabled) {
+        result_cache = std::make_shared<ResultCache>(node_id, cfg.result_cache);
+    }
+    ClientGatewayService clientSvc(processor, session_manager, result_cache, cfg.gateway);
 
     b.AddListeningPort(bind_addr, grpc::InsecureServerCredentials());
     b.RegisterService(&nodeSvc);
@@ -154,87 +174,68 @@ int main(int argc, char** argv){
     LOG_INFO(node_id, "ServerMain", "Node " + node_id + " listening at " + bind_addr + " (public: " + public_addr + ")");
     LOG_INFO(node_id, "ServerMain", "Press Ctrl+C to stop");
     
-    // Start worker task pulling thread for worker nodes
-    std::thread worker_thread;
+    // Peers start in any order; wait for their connections in the background
+    std::thread channel_warmup_thread([&]() {
+        processor->WarmUpChannels(std::chrono::milliseconds(cfg.channel_pool.warmup_ms));
+    });
+    
+    // Start worker task pipeline for worker nodes
+    std::unique_ptr<WorkerExecutor> worker_executor;
+    std::unique_ptr<TaskStreamClient> task_stream;
     std::thread worker_heartbeat_thread;
-    std::atomic<double> last_task_ms(0.0);
     if (node_id == "C" || node_id == "D" || node_id == "F") {
-        worker_thread = std::thread([&]() {
-            // Get team leader stub
-            std::string team_leader_addr;
-            if (node_id == "C") {
-                team_leader_addr = cfg.nodes["B"].host + ":" + std::to_string(cfg.nodes["B"].port);
-            } else {
-                team_leader_addr = cfg.nodes["E"].host + ":" + std::to_string(cfg.nodes["E"].port);
-            }
-            
-            auto channel = grpc::CreateChannel(team_leader_addr, grpc::InsecureChannelCredentials());
-            auto stub = mini2::TeamIngress::NewStub(channel);
-            
-            LOG_INFO(node_id, "WorkerLoop", "Starting task pulling loop");
-            
-            // Idle backoff state
-            int idle_iters = 0;
-            int log_counter = 0;
-            const int LOG_EVERY_N = 50;
-            
-            while (!g_shutdown_requested) {
-                // Request a task from team leader
+        // Get team leader stub
+        std::string team_leader_addr;
+        if (node_id == "C") {
+            team_leader_addr = cfg.nodes["B"].host + ":" + std::to_string(cfg.nodes["B"].port);
+        } else {
+            team_leader_addr = cfg.nodes["E"].host + ":" + std::to_string(cfg.nodes["E"].port);
+        }
+        
+        // Task dispatch rides the control connection, clear of result uploads
+        auto channel = processor->ControlChannel(team_leader_addr);
+        std::shared_ptr<mini2::TeamIngress::Stub> task_stub = mini2::TeamIngress::NewStub(channel);
+        
+        WorkerExecutor::Options opts;
+        const WorkerExecutorConfig& wcfg = cfg.worker_executor;
+        opts.compute_threads = wcfg.compute_threads > 0 ? wcfg.compute_threads
+                             : WorkerExecutor::DefaultComputeThreads(cfg.nodes[node_id].capacity_score);
+        opts.prefetch        = wcfg.prefetch > 0 ? wcfg.prefetch : opts.compute_threads;
+        opts.upload_threads  = wcfg.upload_threads;
+        
+        WorkerExecutor::FetchFn fetch;
+        if (wcfg.stream_tasks) {
+            // Tasks are pushed within the credit window; the stream buffer is the prefetch queue
+            task_stream = std::make_unique<TaskStreamClient>(node_id, task_stub, opts.prefetch);
+            opts.prefetch    = 1;
+            opts.fetch_waits = true;
+            fetch = [stream = task_stream.get()](mini2::Task& task) {
+                return stream->Next(task, std::chrono::milliseconds(500));
+            };
+        } else {
+            // Pull a task from the team leader
+            fetch = [task_stub, node_id](mini2::Task& task) {
                 mini2::NodeId req;
                 req.set_id(node_id);
-                mini2::Task task;
                 grpc::ClientContext ctx;
-                
-                grpc::Status status = stub->RequestTask(&ctx, req, &task);
-                
-                if (status.ok() && !task.request_id().empty()) {
-                    LOG_DEBUG(node_id, "WorkerLoop", 
-                              "Pulled task " + task.request_id() + "." + std::to_string(task.chunk_id()));
-                    
-                    // Reset idle backoff when we get work
-                    idle_iters = 0;
-                    log_counter = 0;
-                    
-                    // Process the task
-                    double processing_ms = 0.0;
-                    auto result = processor->ProcessTask(task, processing_ms);
-                    last_task_ms.store(processing_ms);
-                    
-                    LOG_DEBUG(node_id, "WorkerLoop", 
-                              "Finished task " + task.request_id() + "." + std::to_string(task.chunk_id()) + 
-                              " in " + std::to_string(processing_ms) + "ms");
-                    
-                    // Send result back to team leader
-                    grpc::ClientContext result_ctx;
-                    mini2::HeartbeatAck ack;
-                    status = stub->PushWorkerResult(&result_ctx, result, &ack);
-                    
-                    if (!status.ok()) {
-                        LOG_ERROR(node_id, "WorkerLoop", 
-                                  "Failed to push result: " + status.error_message());
-                    }
-                } else {
-                    // No task available, use exponential backoff
-                    idle_iters++;
-                    log_counter++;
-                    
-                    if (!status.ok()) {
-                        LOG_DEBUG(node_id, "WorkerLoop", 
-                                  "RequestTask failed: " + status.error_message());
-                    } else if (log_counter % LOG_EVERY_N == 1) {
-                        // Log only once every LOG_EVERY_N iterations
-                        LOG_DEBUG(node_id, "WorkerLoop", "No tasks available (logged once per " + 
-                                  std::to_string(LOG_EVERY_N) + " checks)");
-                    }
-                    
-                    // Exponential backoff: 5ms, 10ms, 20ms, 40ms, 80ms, 160ms, 200ms (cap)
-                    int backoff_ms = std::min(5 * (1 << (idle_iters - 1)), 200);
-                    std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+                grpc::Status status = task_stub->RequestTask(&ctx, req, &task);
+                if (!status.ok()) {
+                    LOG_DEBUG(node_id, "WorkerLoop", "RequestTask failed: " + status.error_message());
+                    return false;
                 }
-            }
-            
-            LOG_INFO(node_id, "WorkerLoop", "Stopping task pulling loop");
-        });
+                return !task.request_id().empty();
+            };
+        }
+        
+        worker_executor = std::make_unique<WorkerExecutor>(node_id, opts, std::move(fetch),
+            [processor](const mini2::Task& task, double& processing_ms) {
+                return processor->ProcessTask(task, processing_ms);
+            },
+            // Send result to the gateway (direct path) or back to the team leader
+            [processor](const mini2::Task& task, const mini2::WorkerResult& result) {
+                return processor->DeliverTaskResult(task, result);
+            });
+        worker_executor->Start();
         
         // Start worker heartbeat sending thread
         worker_heartbeat_thread = std::thread([&]() {
@@ -245,7 +246,7 @@ int main(int argc, char** argv){
                 team_leader_addr = cfg.nodes["E"].host + ":" + std::to_string(cfg.nodes["E"].port);
             }
             
-            auto channel = grpc::CreateChannel(team_leader_addr, grpc::InsecureChannelCredentials());
+            auto channel = processor->ControlChannel(team_leader_addr);
             auto node_ctrl_stub = mini2::NodeControl::NewStub(channel);
             
             LOG_INFO(node_id, "WorkerHeartbeat", "Starting heartbeat thread");
@@ -259,8 +260,10 @@ int main(int argc, char** argv){
                 hb.set_from(node_id);
                 hb.set_ts_unix_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch()).count());
-                hb.set_recent_task_ms(last_task_ms.load());
-                hb.set_queue_len(0); // Workers process one task at a time
+                hb.set_recent_task_ms(worker_executor->LastTaskMs());
+                hb.set_recent_rows_per_sec(worker_executor->LastRowsPerSec());
+                size_t depth = worker_executor->QueueDepth() + (task_stream ? task_stream->Buffered() : 0);
+                hb.set_queue_len(static_cast<uint32_t>(depth));
                 hb.set_capacity_score(cfg.nodes[node_id].capacity_score);
                 
                 grpc::ClientContext ctx;
@@ -293,12 +296,23 @@ int main(int argc, char** argv){
                 << " | queue=" << status.queue_size()
                 << " | uptime=" << status.uptime_seconds() << "s"
                 << " | requests=" << status.requests_processed();
+            if (node_id == "A") {
+                auto chunks = session_manager->GetChunkStoreStats();
+                oss << " | chunks mem=" << chunks.memory_bytes / (1024 * 1024) << "/"
+                    << chunks.budget_bytes / (1024 * 1024) << "MB"
+                    << " spilled=" << chunks.spilled_bytes / (1024 * 1024) << "MB"
+                    << " (total " << chunks.spill_bytes_total / (1024 * 1024) << "MB"
+                    << ", write " << chunks.avg_spill_write_ms << "ms"
+                    << ", read " << chunks.avg_spill_read_ms << "ms"
+                    << ", errors " << chunks.spill_errors << ")";
+            }
             LOG_INFO(node_id, "Heartbeat", oss.str());
         }
     });
     
     // Start maintenance thread for team leaders
     std::thread maintenance_thread;
+    std::thread peer_steal_thread;
     if (node_id == "B" || node_id == "E") {
         maintenance_thread = std::thread([&]() {
             LOG_INFO(node_id, "Maintenance", "Starting maintenance thread");
@@ -312,6 +326,17 @@ int main(int argc, char** argv){
             
             LOG_INFO(node_id, "Maintenance", "Stopping maintenance thread");
         });
+        
+        // Cross-team stealing runs on its own period (StealFromPeers rate-limits itself)
+        peer_steal_thread = std::thread([&]() {
+            const auto interval = std::chrono::milliseconds(std::max<uint32_t>(10, cfg.cross_team_steal.interval_ms));
+            while (!g_shutdown_requested) {
+                std::this_thread::sleep_for(interval);
+                if (g_shutdown_requested) break;
+                
+                processor->StealFromPeers();
+            }
+        });
     }
     
     while (!g_shutdown_requested && !processor->IsShuttingDown()) {
@@ -320,6 +345,10 @@ int main(int argc, char** argv){
     
     LOG_INFO(node_id, "ServerMain", "Initiating graceful shutdown...");
     
+    if (channel_warmup_thread.joinable()) {
+        channel_warmup_thread.join();
+    }
+    
     // Stop heartbeat thread
     heartbeat_running = false;
     if (heartbeat_thread.joinable()) {
@@ -330,10 +359,16 @@ int main(int argc, char** argv){
     if (maintenance_thread.joinable()) {
         maintenance_thread.join();
     }
+    if (peer_steal_thread.joinable()) {
+        peer_steal_thread.join();
+    }
     
-    // Stop worker thread
-    if (worker_thread.joinable()) {
-        worker_thread.join();
+    // Stop worker pipeline (finishes tasks already prefetched)
+    if (task_stream) {
+        task_stream->Stop();
+    }
+    if (worker_executor) {
+        worker_executor->Stop();
     }
     
     // Stop worker heartbeat thread
@@ -341,6 +376,11 @@ int main(int argc, char** argv){
         worker_heartbeat_thread.join();
     }
     
+    // Gateway: let admitted requests finish so their sessions get every chunk
+    if (node_id == "A" && !clientSvc.Drain(std::chrono::seconds(15))) {
+        LOG_WARN(node_id, "ServerMain", "Gateway requests still running at shutdown");
+    }
+    
     auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(5);
     server->Shutdown(deadline);
     
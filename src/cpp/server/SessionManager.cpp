@@ -6,9 +6,17 @@
 #include <sstream>
 #include <iomanip>
 #include <random>
+#include <algorithm>
 
-SessionManager::SessionManager() {
-    std::cout << "[SessionManager] init" << std::endl;
+namespace {
+// Longest a GetNext stays parked (longer than the team leader timeout of 300s)
+constexpr std::chrono::seconds kChunkWaitTimeout{310};
+}
+
+SessionManager::SessionManager(const SessionConfig& config, const ChunkStoreConfig& chunk_store)
+    : config_(config), chunk_store_(chunk_store), shards_(std::max<uint32_t>(config.shards, 1)),
+      session_timeout_(config.resume_grace_s) {
+    std::cout << "[SessionManager] init (" << shards_.size() << " shards)" << std::endl;
     StartCleanupThread();
 }
 
@@ -33,120 +41,382 @@ std::string SessionManager::GenerateSessionId() {
 }
 
 std::string SessionManager::CreateSession(const mini2::Request& req) {
-    std::string session_id = GenerateSessionId();
-    
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    // Use emplace to construct in place (avoids copy/move of mutex)
-    auto& session = sessions_[session_id];
-    session.request_id = session_id;
-    session.created_at = std::chrono::steady_clock::now();
-    session.last_access = std::chrono::steady_clock::now();
-    session.complete = false;
-    session.next_poll_index = 0;
+    // Built before it is published: other threads never see it half-initialised
+    auto session = std::make_shared<Session>();
+    session->delivery = req.delivery();
+    session->created_at = std::chrono::steady_clock::now();
+    session->last_access = session->created_at;
+    
+    // IDs made in the same millisecond can collide; never hand out a live one twice
+    std::string session_id;
+    for (bool inserted = false; !inserted; ) {
+        session_id = GenerateSessionId();
+        session->request_id = session_id;
+        Shard& shard = ShardFor(session_id);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        inserted = shard.sessions.emplace(session_id, session).second;
+    }
     
     std::cout << "[SessionManager] new session " << session_id 
-              << " query=" << req.query() << std::endl;
+              << " query=" << req.query()
+              << (req.delivery() == mini2::DELIVERY_UNORDERED ? " unordered" : " ordered") << std::endl;
     
     return session_id;
 }
 
-void SessionManager::AddChunk(const std::string& session_id, const mini2::WorkerResult& result) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
-        std::cerr << "[SessionManager] Session not found: " << session_id << std::endl;
-        return;
+SessionManager::Shard& SessionManager::ShardFor(const std::string& session_id) {
+    return shards_[std::hash<std::string>{}(session_id) % shards_.size()];
+}
+
+std::shared_ptr<SessionManager::Session> SessionManager::Acquire(const std::string& session_id,
+                                                                 std::unique_lock<std::mutex>& lock) {
+    std::shared_ptr<Session> session;
+    {
+        Shard& shard = ShardFor(session_id);
+        std::shared_lock<std::shared_mutex> shard_lock(shard.mutex);
+        auto it = shard.sessions.find(session_id);
+        if (it == shard.sessions.end()) return nullptr;
+        session = it->second;
     }
-    
-    Session& session = it->second;
-    std::lock_guard<std::mutex> session_lock(session.mutex);
-    
-    session.chunks.push_back(result);
-    
-    std::cout << "[SessionManager] add chunk " << result.part_index() 
-              << " -> " << session_id 
-              << " total=" << session.chunks.size() << std::endl;
-    
-    // Notify waiting threads (for GetNext)
-    session.cv.notify_all();
+    lock = std::unique_lock<std::mutex>(session->mutex);
+    if (session->erased) {
+        lock.unlock();
+        return nullptr;
+    }
+    return session;
 }
 
-bool SessionManager::GetNextChunk(const std::string& session_id, uint32_t index, 
-                                   mini2::NextChunkResp* resp) {
-    std::unique_lock<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
-        std::cerr << "[SessionManager] GetNext: Session not found: " << session_id << std::endl;
+void SessionManager::AddChunk(const std::string& session_id, Chunk chunk) {
+    const std::string origin = chunk->origin();
+    const uint32_t frame_count = chunk->frame_count();
+    
+    // Stored (possibly spilled) before any session lock is taken
+    ChunkStore::Ref stored = chunk_store_.Put(session_id, std::move(chunk));
+    Completions ready;
+    {
+        std::unique_lock<std::mutex> session_lock;
+        auto session = Acquire(session_id, session_lock);
+        if (!session) {
+            std::cerr << "[SessionManager] Session not found: " << session_id << std::endl;
+            return;
+        }
+        
+        std::cout << "[SessionManager] add chunk " << stored->part_index() 
+                  << " -> " << session_id 
+                  << (stored->spilled() ? " (spilled)" : "");
+        bool duplicate = false;
+        if (session->delivery == mini2::DELIVERY_UNORDERED) {
+            session->chunks.push_back(std::move(stored));
+        } else {
+            duplicate = !ReleaseInOrder(*session, origin, frame_count, std::move(stored));
+        }
+        std::cout << " total=" << session->chunks.size() << " held=" << session->held.size() << std::endl;
+        if (duplicate) {
+            std::cerr << "[SessionManager] duplicate chunk from " << origin << " for " << session_id
+                      << " (already held), dropped" << std::endl;
+        }
+        
+        // Answer parked GetNext calls
+        ReleaseReadyWaiters(*session, session_id, ready);
+    }
+    for (auto& complete : ready) complete();
+}
+
+void SessionManager::AddChunks(const std::string& session_id, const std::shared_ptr<const std::vector<Chunk>>& results) {
+    for (const auto& result : *results) {
+        AddChunk(session_id, result);
+    }
+}
+
+bool SessionManager::ReleaseInOrder(Session& session, const std::string& origin, uint32_t frame_count,
+                                    ChunkStore::Ref chunk) {
+    // The first team to deliver leads; its parts go out as soon as they are contiguous
+    if (!session.run_started) {
+        session.run_started = true;
+        session.run_origin = origin;
+    }
+    const uint32_t part = chunk->part_index();
+    const uint32_t frame = chunk->frame_index();
+    if (!session.held.emplace(std::make_tuple(origin, part, frame), Session::Held{std::move(chunk), frame_count}).second) {
         return false;
     }
     
-    Session& session = it->second;
-    session.last_access = std::chrono::steady_clock::now();  // Update access time
-    lock.unlock();  // Release sessions_ lock
-    
-    std::unique_lock<std::mutex> session_lock(session.mutex);
+    auto next = session.held.find(std::make_tuple(session.run_origin, session.next_part, session.next_frame));
+    while (next != session.held.end()) {
+        if (next->second.frame_count > 0 && session.next_frame + 1 < next->second.frame_count) {
+            session.next_frame++;
+        } else {
+            session.next_part++;
+            session.next_frame = 0;
+        }
+        session.chunks.push_back(std::move(next->second.chunk));
+        session.held.erase(next);
+        next = session.held.find(std::make_tuple(session.run_origin, session.next_part, session.next_frame));
+    }
+    return true;
+}
+
+void SessionManager::FlushHeld(Session& session, const std::string& session_id) {
+    if (!session.held.empty()) {
+        std::cout << "[SessionManager] end of run for " << session_id << ": releasing "
+                  << session.held.size() << " held chunk(s) in order" << std::endl;
+    }
+    for (auto& [key, held] : session.held) {
+        session.chunks.push_back(std::move(held.chunk));
+    }
+    session.held.clear();
     
-        // Wait until chunk is available or session is complete
-    while (index >= session.chunks.size() && !session.complete) {
-        std::cout << "[SessionManager] wait chunk " << index 
-              << " in " << session_id << std::endl;
-        
-        // Wait with timeout (310 seconds - longer than team leader timeout of 300s)
-        if (session.cv.wait_for(session_lock, std::chrono::seconds(310)) == std::cv_status::timeout) {
-            std::cerr << "[SessionManager] timeout waiting for chunk " << index << std::endl;
-            return false;
+    // The next team to deliver starts a new run
+    session.run_started = false;
+    session.run_origin.clear();
+    session.next_part = 0;
+    session.next_frame = 0;
+}
+
+void SessionManager::FlushOrdered(const std::string& session_id) {
+    Completions ready;
+    {
+        std::unique_lock<std::mutex> session_lock;
+        auto session = Acquire(session_id, session_lock);
+        if (!session) return;
+        FlushHeld(*session, session_id);
+        ReleaseReadyWaiters(*session, session_id, ready);
+    }
+    for (auto& complete : ready) complete();
+}
+
+void SessionManager::GetNextChunkAsync(const std::string& session_id, uint32_t index, uint64_t byte_offset,
+                                       mini2::NextChunkResp* resp, const void* waiter,
+                                       ChunkCallback done) {
+    PrefetchChunkAsync(session_id, index, byte_offset, index, resp, waiter, std::move(done));
+}
+
+void SessionManager::PrefetchChunkAsync(const std::string& session_id, uint32_t index, uint64_t byte_offset,
+                                        uint32_t acked, mini2::NextChunkResp* resp, const void* waiter,
+                                        ChunkCallback done) {
+    ChunkReply reply;
+    {
+        std::unique_lock<std::mutex> session_lock;
+        auto found = Acquire(session_id, session_lock);
+        if (!found) {
+            std::cerr << "[SessionManager] GetNext: Session not found: " << session_id << std::endl;
+            reply.outcome = ChunkOutcome::NOT_FOUND;
+        } else {
+            Session& session = *found;
+            session.last_access = std::chrono::steady_clock::now();  // Update access time
+            ReleaseConsumed(session, session_id, acked);
+            
+            // Chunk not produced yet: park until it is or the session ends
+            if (index >= session.chunks.size() && !session.complete) {
+                std::cout << "[SessionManager] wait chunk " << index 
+                          << " in " << session_id << std::endl;
+                session.waiters.push_back({index, byte_offset, resp, waiter, std::move(done),
+                                           std::chrono::steady_clock::now() + kChunkWaitTimeout});
+                return;
+            }
+            reply = FillChunk(session, session_id, index, byte_offset, resp);
         }
-    }    // Check if chunk is available
+    }
+    done(Deliver(reply, resp->mutable_chunk()));
+}
+
+bool SessionManager::CancelChunkWait(const std::string& session_id, const void* waiter) {
+    std::unique_lock<std::mutex> session_lock;
+    auto session = Acquire(session_id, session_lock);
+    if (!session) return false;  // erased: its waiters were already answered
+    
+    auto& waiters = session->waiters;
+    auto w = std::find_if(waiters.begin(), waiters.end(),
+                          [waiter](const Session::ChunkWaiter& cw) { return cw.id == waiter; });
+    if (w == waiters.end()) return false;
+    waiters.erase(w);
+    return true;
+}
+
+size_t SessionManager::ParkedWaiters() {
+    size_t parked = 0;
+    for (auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> shard_lock(shard.mutex);
+        for (auto& [id, session] : shard.sessions) {
+            std::lock_guard<std::mutex> session_lock(session->mutex);
+            parked += session->waiters.size();
+        }
+    }
+    return parked;
+}
+
+SessionManager::ChunkReply SessionManager::FillChunk(Session& session, const std::string& session_id,
+                                                     uint32_t index, uint64_t byte_offset,
+                                                     mini2::NextChunkResp* resp) {
+    if (session.rejected) {
+        resp->set_request_id(session_id);
+        resp->set_has_more(false);
+        return {nullptr, ChunkOutcome::REJECTED};
+    }
+    
+    // Check if chunk is available
     if (index < session.chunks.size()) {
-        const auto& chunk = session.chunks[index];
         resp->set_request_id(session_id);
-        resp->set_chunk(chunk.payload());
         
         // Check if more chunks are coming
         bool has_more = (index + 1 < session.chunks.size()) || !session.complete;
         resp->set_has_more(has_more);
         
+        if (index < session.released_below) {
+            std::cerr << "[SessionManager] chunk " << index << " of " << session_id
+                      << " already released (window starts at " << session.released_below << ")" << std::endl;
+            return {nullptr, ChunkOutcome::RELEASED};
+        }
+        
+        const ChunkStore::Ref& chunk = session.chunks[index];
+        session.served_below = std::max(session.served_below, index + 1);
+        resp->set_part_index(chunk->part_index());
+        resp->set_frame_index(chunk->frame_index());
+        resp->mutable_continuation()->set_session_id(session_id);
+        resp->mutable_continuation()->set_chunk_index(index + 1);
+        resp->mutable_continuation()->set_byte_offset(0);  // replies carry whole chunks
+        
         std::cout << "[SessionManager] got chunk " << index 
-              << " has_more=" << has_more << std::endl;
+              << " (part " << chunk->part_index() << ") has_more=" << has_more;
+        if (byte_offset > 0) std::cout << " from byte " << byte_offset;
+        std::cout << std::endl;
         
-        return true;
+        return {chunk, ChunkOutcome::FOUND, byte_offset};
     }
     
     // Session complete but no chunk at this index
     resp->set_request_id(session_id);
     resp->set_has_more(false);
+    resp->mutable_continuation()->set_session_id(session_id);
+    resp->mutable_continuation()->set_chunk_index(index);
+    resp->mutable_continuation()->set_byte_offset(0);
     
     std::cout << "[SessionManager] complete, no more chunks" << std::endl;
-    return false;
+    return {nullptr, ChunkOutcome::END};
 }
 
-bool SessionManager::PollNextChunk(const std::string& session_id, mini2::PollResp* resp) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
+SessionManager::ChunkOutcome SessionManager::Deliver(const ChunkReply& reply, std::string* out) {
+    if (reply.outcome != ChunkOutcome::FOUND) return reply.outcome;
+    if (!chunk_store_.Read(*reply.chunk, out, reply.byte_offset)) {
+        std::cerr << "[SessionManager] failed to read back chunk " << reply.chunk->part_index() << std::endl;
+        return ChunkOutcome::READ_ERROR;
+    }
+    return ChunkOutcome::FOUND;
+}
+
+void SessionManager::ReleaseConsumed(Session& session, const std::string& session_id, uint32_t cursor) {
+    if (!config_.sliding_window) return;
+    // The cursor is whatever the client asked for; a request far ahead must not drop
+    // chunks it has never been sent, so nothing past what was served goes
+    uint32_t keep_from = cursor > config_.reread_window ? cursor - config_.reread_window : 0;
+    keep_from = std::min(keep_from, session.served_below);
+    if (keep_from <= session.released_below) return;
+    
+    // Dropping the last reference gives the memory (or spill file space) back
+    for (uint32_t i = session.released_below; i < keep_from; ++i) {
+        session.chunks[i].reset();
+    }
+    std::cout << "[SessionManager] released chunks " << session.released_below << "-" << keep_from - 1
+              << " of " << session_id << std::endl;
+    session.released_below = keep_from;
+}
+
+void SessionManager::ReleaseReadyWaiters(Session& session, const std::string& session_id,
+                                         Completions& out) {
+    auto& waiters = session.waiters;
+    for (auto it = waiters.begin(); it != waiters.end(); ) {
+        if (it->index < session.chunks.size() || session.complete) {
+            ChunkReply reply = FillChunk(session, session_id, it->index, it->byte_offset, it->resp);
+            session.last_access = std::chrono::steady_clock::now();
+            out.push_back([this, reply = std::move(reply), resp = it->resp, done = std::move(it->done)]() {
+                done(Deliver(reply, resp->mutable_chunk()));
+            });
+            it = waiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SessionManager::ReleaseAllWaiters(Session& session, const std::string& session_id,
+                                       Completions& out) {
+    for (auto& w : session.waiters) {
+        w.resp->set_request_id(session_id);
+        w.resp->set_has_more(false);
+        out.push_back([done = std::move(w.done)]() { done(ChunkOutcome::END); });
+    }
+    session.waiters.clear();
+}
+
+void SessionManager::ExpireChunkWaiters() {
+    Completions expired;
+    auto now = std::chrono::steady_clock::now();
+    for (auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> shard_lock(shard.mutex);
+        for (auto& [session_id, session] : shard.sessions) {
+            std::lock_guard<std::mutex> session_lock(session->mutex);
+            auto& waiters = session->waiters;
+            for (auto it = waiters.begin(); it != waiters.end(); ) {
+                if (it->deadline > now) {
+                    ++it;
+                    continue;
+                }
+                std::cerr << "[SessionManager] timeout waiting for chunk " << it->index << std::endl;
+                session->last_access = now;  // the grace period runs from the answer on
+                it->resp->set_request_id(session_id);
+                it->resp->set_has_more(false);
+                expired.push_back([done = std::move(it->done)]() { done(ChunkOutcome::END); });
+                it = waiters.erase(it);
+            }
+        }
+    }
+    for (auto& complete : expired) complete();
+}
+
+bool SessionManager::PollNextChunk(const std::string& session_id, mini2::PollResp* resp, bool* rejected) {
+    std::unique_lock<std::mutex> session_lock;
+    auto found = Acquire(session_id, session_lock);
+    if (!found) {
         std::cerr << "[SessionManager] PollNext: Session not found: " << session_id << std::endl;
         return false;
     }
     
-    Session& session = it->second;
+    Session& session = *found;
     session.last_access = std::chrono::steady_clock::now();  // Update access time
-    std::lock_guard<std::mutex> session_lock(session.mutex);
+    if (session.rejected) {
+        if (rejected) *rejected = true;
+        return false;
+    }
     
     resp->set_request_id(session_id);
     
+    // Everything before the poll cursor has been handed out
+    ReleaseConsumed(session, session_id, session.next_poll_index);
+    if (session.next_poll_index < session.released_below) {
+        std::cerr << "[SessionManager] PollNext: chunk " << session.next_poll_index
+                  << " already released for " << session_id << std::endl;
+        return false;
+    }
+    
     // Check if next chunk is available
     if (session.next_poll_index < session.chunks.size()) {
-        const auto& chunk = session.chunks[session.next_poll_index];
-        
+        // Read under the lock: a failed read must leave next_poll_index where it is
+        ChunkReply reply{session.chunks[session.next_poll_index], ChunkOutcome::FOUND};
+        if (Deliver(reply, resp->mutable_chunk()) != ChunkOutcome::FOUND) {
+            resp->set_ready(false);
+            resp->set_has_more(true);  // poll again
+            return true;
+        }
         resp->set_ready(true);
-        resp->set_chunk(chunk.payload());
+        resp->set_part_index(reply.chunk->part_index());
+        resp->set_frame_index(reply.chunk->frame_index());
         
         // Increment for next poll
         session.next_poll_index++;
+        session.served_below = std::max(session.served_below, session.next_poll_index);
+        resp->mutable_continuation()->set_session_id(session_id);
+        resp->mutable_continuation()->set_chunk_index(session.next_poll_index);
+        resp->mutable_continuation()->set_byte_offset(0);
         
         // Check if more chunks are coming
         bool has_more = (session.next_poll_index < session.chunks.size()) || !session.complete;
@@ -169,58 +439,152 @@ bool SessionManager::PollNextChunk(const std::string& session_id, mini2::PollRes
     return true;
 }
 
-void SessionManager::CompleteSession(const std::string& session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
-        std::cerr << "[SessionManager] CompleteSession: Session not found: " << session_id << std::endl;
-        return;
+bool SessionManager::ResumeSession(const mini2::ContinuationToken& token, mini2::ResumeResp* resp) {
+    const std::string& session_id = token.session_id();
+    std::unique_lock<std::mutex> session_lock;
+    auto found = Acquire(session_id, session_lock);
+    if (!found) {
+        std::cerr << "[SessionManager] Resume: Session not found: " << session_id << std::endl;
+        resp->set_error("session expired or unknown");
+        return false;
     }
     
-    Session& session = it->second;
-    std::lock_guard<std::mutex> session_lock(session.mutex);
+    Session& session = *found;
+    session.last_access = std::chrono::steady_clock::now();
+    if (session.rejected) {
+        resp->set_error("request was rejected");
+        return false;
+    }
+    if (token.chunk_index() < session.released_below) {
+        std::cerr << "[SessionManager] Resume: chunk " << token.chunk_index() << " of " << session_id
+                  << " already released (window starts at " << session.released_below << ")" << std::endl;
+        resp->set_error("chunk already released");
+        return false;
+    }
+    if (token.chunk_index() > session.chunks.size()) {
+        std::cerr << "[SessionManager] Resume: chunk " << token.chunk_index() << " of " << session_id
+                  << " was never sent (" << session.chunks.size() << " so far)" << std::endl;
+        resp->set_error("chunk index past the session's chunks");
+        return false;
+    }
+    if (token.byte_offset() > 0 && (token.chunk_index() == session.chunks.size() ||
+                                    token.byte_offset() > session.chunks[token.chunk_index()]->size())) {
+        std::cerr << "[SessionManager] Resume: byte " << token.byte_offset() << " is past the end of chunk "
+                  << token.chunk_index() << " of " << session_id << std::endl;
+        resp->set_error("byte offset past the end of the chunk");
+        return false;
+    }
     
-    session.complete = true;
+    // PollNext keeps its cursor here; a reply lost with the connection is served again
+    session.next_poll_index = token.chunk_index();
     
-    std::cout << "[SessionManager] done session " << session_id 
-              << " chunks=" << session.chunks.size() << std::endl;
+    *resp->mutable_resume_at() = token;
+    resp->set_ok(true);
+    resp->set_has_more(token.chunk_index() < session.chunks.size() || !session.complete);
     
-    // Notify all waiting threads
-    session.cv.notify_all();
+    std::cout << "[SessionManager] resume " << session_id << " at chunk " << token.chunk_index()
+              << " byte " << token.byte_offset() << " (of " << session.chunks.size()
+              << (session.complete ? ", complete)" : ", more coming)") << std::endl;
+    return true;
 }
 
-void SessionManager::CleanupSession(const std::string& session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        sessions_.erase(it);
-        std::cout << "[SessionManager] erase session " << session_id << std::endl;
+void SessionManager::CompleteSession(const std::string& session_id) {
+    Completions ready;
+    {
+        std::unique_lock<std::mutex> session_lock;
+        auto session = Acquire(session_id, session_lock);
+        if (!session) {
+            std::cerr << "[SessionManager] CompleteSession: Session not found: " << session_id << std::endl;
+            return;
+        }
+        
+        session->complete = true;
+        FlushHeld(*session, session_id);  // nothing more is coming for held-back parts
+        
+        std::cout << "[SessionManager] done session " << session_id 
+                  << " chunks=" << session->chunks.size() << std::endl;
+        
+        // Answer every parked GetNext
+        ReleaseReadyWaiters(*session, session_id, ready);
     }
+    for (auto& complete : ready) complete();
 }
 
-void SessionManager::CleanupOldSessions(std::chrono::seconds max_age) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto now = std::chrono::steady_clock::now();
-    int cleaned = 0;
-    
-    for (auto it = sessions_.begin(); it != sessions_.end(); ) {
-        auto age = std::chrono::duration_cast<std::chrono::seconds>(
-            now - it->second.created_at);
+void SessionManager::RejectSession(const std::string& session_id) {
+    Completions ready;
+    {
+        std::unique_lock<std::mutex> session_lock;
+        auto session = Acquire(session_id, session_lock);
+        if (!session) {
+            std::cerr << "[SessionManager] RejectSession: Session not found: " << session_id << std::endl;
+            return;
+        }
         
-        if (age > max_age && it->second.complete) {
-            it = sessions_.erase(it);
-            cleaned++;
-        } else {
-            ++it;
+        session->rejected = true;
+        session->complete = true;
+        std::cout << "[SessionManager] rejected session " << session_id << std::endl;
+        
+        // Parked GetNext calls fail now (FillChunk answers REJECTED)
+        ReleaseReadyWaiters(*session, session_id, ready);
+    }
+    for (auto& complete : ready) complete();
+}
+
+void SessionManager::CleanupSession(const std::string& session_id) {
+    Completions released;
+    {
+        Shard& shard = ShardFor(session_id);
+        std::unique_lock<std::shared_mutex> shard_lock(shard.mutex);
+        
+        auto it = shard.sessions.find(session_id);
+        if (it != shard.sessions.end()) {
+            {
+                std::lock_guard<std::mutex> session_lock(it->second->mutex);
+                it->second->erased = true;
+                ReleaseAllWaiters(*it->second, session_id, released);
+            }
+            shard.sessions.erase(it);
+            std::cout << "[SessionManager] erase session " << session_id << std::endl;
         }
     }
+    for (auto& complete : released) complete();
+}
+
+void SessionManager::CleanupOldSessions(std::chrono::seconds max_age) {
+    Completions released;
+    auto now = std::chrono::steady_clock::now();
+    size_t cleaned = EraseSessions([&](const Session& session) {
+        return now - session.created_at > max_age && session.complete;
+    }, "old", released);
     
     if (cleaned > 0) {
         std::cout << "[SessionManager] cleaned " << cleaned << " old session(s)" << std::endl;
     }
+    for (auto& complete : released) complete();
+}
+
+size_t SessionManager::EraseSessions(const std::function<bool(const Session&)>& expired, const char* reason,
+                                     Completions& released) {
+    size_t erased = 0;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> shard_lock(shard.mutex);
+        for (auto it = shard.sessions.begin(); it != shard.sessions.end(); ) {
+            Session& session = *it->second;
+            {
+                std::lock_guard<std::mutex> session_lock(session.mutex);
+                if (!expired(session)) {
+                    ++it;
+                    continue;
+                }
+                session.erased = true;
+                ReleaseAllWaiters(session, it->first, released);
+            }
+            std::cout << "[SessionManager] " << reason << " session " << it->first << std::endl;
+            it = shard.sessions.erase(it);
+            erased++;
+        }
+    }
+    return erased;
 }
 
 void SessionManager::StartCleanupThread() {
@@ -240,9 +604,12 @@ void SessionManager::StopCleanupThread() {
 
 void SessionManager::CleanupThreadFunc() {
     while (cleanup_running_) {
-        // Sleep for 60 seconds between cleanup runs
+        // Sleep for 60 seconds between cleanup runs, timing out parked GetNext calls
+        // and spilling chunks down to the memory budget meanwhile
         for (int i = 0; i < 60 && cleanup_running_; i++) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
+            ExpireChunkWaiters();
+            chunk_store_.Trim();
         }
         
         if (!cleanup_running_) break;
@@ -252,33 +619,18 @@ void SessionManager::CleanupThreadFunc() {
 }
 
 void SessionManager::CleanupStaleSessions() {
+    Completions released;
     auto now = std::chrono::steady_clock::now();
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    std::vector<std::string> to_remove;
-    
-    // Find stale sessions
-    for (auto& pair : sessions_) {
-        auto& session = pair.second;
-        
-        // Check if session is stale (no access for timeout duration)
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            now - session.last_access);
-        
-        if (elapsed > session_timeout_) {
-            to_remove.push_back(pair.first);
-        }
-    }
     
-    // Remove stale sessions
-    for (const auto& session_id : to_remove) {
-        sessions_.erase(session_id);
-        std::cout << "[SessionManager] stale session " << session_id 
-              << " (>" << session_timeout_.count() << "s)" << std::endl;
-    }
+    // Stale: no access for the timeout duration. A parked GetNext counts as access,
+    // however long it waits: erasing under it would answer END and cut the result short.
+    size_t removed = EraseSessions([&](const Session& session) {
+        return session.waiters.empty() && now - session.last_access > session_timeout_;
+    }, "stale", released);
     
-    if (!to_remove.empty()) {
+    if (removed > 0) {
         std::cout << "[SessionManager] cleanup removed " 
-              << to_remove.size() << " stale session(s)" << std::endl;
+              << removed << " stale session(s) (>" << session_timeout_.count() << "s)" << std::endl;
     }
+    for (auto& complete : released) complete();
 }
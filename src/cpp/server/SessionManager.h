@@ -1,35 +1,105 @@
 #pragma once
 
 #include "minitwo.grpc.pb.h"
+#include "ChunkStore.h"
+#include "../common/config.h"
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
+#include <tuple>
+#include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <chrono>
-#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <thread>
 
+// Sessions live in a hash table split into shards, each under its own reader/writer
+// lock. A lookup holds its shard's lock only long enough to take a reference to the
+// session; everything else happens under that session's own mutex, so calls on
+// different sessions never wait for each other.
 class SessionManager {
 public:
-    SessionManager();
+    explicit SessionManager(const SessionConfig& config = SessionConfig(),
+                            const ChunkStoreConfig& chunk_store = ChunkStoreConfig());
     ~SessionManager();
     
-    // Create new session for a request
+    // Create new session for a request; `req.delivery()` picks its delivery mode
     std::string CreateSession(const mini2::Request& req);
     
-    // Add chunk to session (called as results arrive from workers)
-    void AddChunk(const std::string& session_id, const mini2::WorkerResult& result);
+    // Add chunk to session (called as results arrive from workers). Chunks are held
+    // by shared pointer: the payload is never copied into the session. Past the
+    // chunk store's memory budget the payload is spilled to disk instead.
+    // Unordered sessions can serve the chunk right away; ordered ones hold it back
+    // until every part before it (same team, lower part_index/frame_index) is in.
+    using Chunk = ChunkStore::Chunk;
+    void AddChunk(const std::string& session_id, Chunk chunk);
     
-    // Get next chunk by index (blocking - waits if chunk not ready yet)
-    bool GetNextChunk(const std::string& session_id, uint32_t index, 
-                      mini2::NextChunkResp* resp);
+    // Ordered sessions: the current team has delivered everything it will, so
+    // release what is still held back (in order, skipping missing parts)
+    void FlushOrdered(const std::string& session_id);
     
-    // Poll for next available chunk (non-blocking)
-    bool PollNextChunk(const std::string& session_id, mini2::PollResp* resp);
+    // Adds every result of a finished set in order; the chunks are shared, so cached
+    // and coalesced sessions all point at the same payloads
+    void AddChunks(const std::string& session_id, const std::shared_ptr<const std::vector<Chunk>>& results);
+    
+    // Completion of a GetNext
+    enum class ChunkOutcome {
+        FOUND,       // resp holds the chunk
+        END,         // no such chunk: session ended, was closed, or the wait timed out (has_more=false)
+        NOT_FOUND,   // no such session: unknown, or expired before the call
+        RELEASED,    // chunk was consumed and dropped by the sliding window
+        READ_ERROR,  // spilled chunk could not be read back
+        REJECTED,    // the session's request was turned away (RejectSession): no chunks will come
+    };
+    using ChunkCallback = std::function<void(ChunkOutcome outcome)>;
+    
+    // Get next chunk by index. Fills `resp` and calls `done` right away if the chunk is
+    // there or the session has ended; otherwise the call is parked (no thread held) until
+    // AddChunk/CompleteSession, session cleanup or the wait limit. `waiter` identifies the
+    // parked call for CancelChunkWait. `done` runs without any SessionManager lock held.
+    // Asking for `index` acknowledges every chunk below it: with the sliding window on,
+    // chunks more than reread_window behind the highest index asked for are released.
+    // The chunk is served from `byte_offset` on; resp->continuation() says what to ask next.
+    void GetNextChunkAsync(const std::string& session_id, uint32_t index, uint64_t byte_offset,
+                           mini2::NextChunkResp* resp, const void* waiter, ChunkCallback done);
+    
+    // For FetchChunks streams, which send ahead of what the client has read: as
+    // GetNextChunkAsync, but only chunks below `acked` count as acknowledged
+    void PrefetchChunkAsync(const std::string& session_id, uint32_t index, uint64_t byte_offset,
+                            uint32_t acked, mini2::NextChunkResp* resp, const void* waiter,
+                            ChunkCallback done);
+    
+    // Unparks a waiting GetNext (client went away); true if it was still parked,
+    // in which case its callback never runs
+    bool CancelChunkWait(const std::string& session_id, const void* waiter);
+    
+    size_t ParkedWaiters();
+    ChunkStore::Stats GetChunkStoreStats() const { return chunk_store_.GetStats(); }
+    
+    // Spills chunks nobody but the sessions holds until the store is under its
+    // budget again; call once a request's result set has been let go of
+    void TrimChunks() { chunk_store_.Trim(); }
+    
+    // Poll for next available chunk (non-blocking); false if the session is unknown,
+    // its next chunk was released, or it was rejected (then `*rejected` is set)
+    bool PollNextChunk(const std::string& session_id, mini2::PollResp* resp, bool* rejected = nullptr);
+    
+    // Picks a session up again after the client reconnects: checks the session is still
+    // retained (idle sessions are kept for resume_grace_s), the token's chunk is still
+    // held and its byte offset lies within that chunk, and moves the PollNext cursor back
+    // to it. False (with resp->error()) otherwise.
+    bool ResumeSession(const mini2::ContinuationToken& token, mini2::ResumeResp* resp);
     
     // Mark session as complete (no more chunks coming)
     void CompleteSession(const std::string& session_id);
     
+    // The session's request will not run (admission refused it): every fetch, parked or
+    // later, fails with REJECTED instead of looking like an empty result
+    void RejectSession(const std::string& session_id);
+    
     // Cleanup session data
     void CleanupSession(const std::string& session_id);
     
@@ -43,22 +113,66 @@ public:
 private:
     struct Session {
         std::string request_id;
-        std::vector<mini2::WorkerResult> chunks;
+        std::vector<ChunkStore::Ref> chunks;
         bool complete = false;
+        bool rejected = false;         // RejectSession: complete, and fetches fail
         uint32_t next_poll_index = 0;  // For PollNext tracking
+        uint32_t released_below = 0;   // sliding window: chunks [0, released_below) are dropped
+        uint32_t served_below = 0;     // one past the highest chunk handed out; nothing above is released
+        mini2::DeliveryMode delivery = mini2::DELIVERY_ORDERED;
+        
+        // Ordered delivery: one team at a time ("run"), its parts released as they become
+        // contiguous; chunks that arrived ahead of their turn wait here
+        struct Held {
+            ChunkStore::Ref chunk;
+            uint32_t frame_count;
+        };
+        std::map<std::tuple<std::string, uint32_t, uint32_t>, Held> held;  // (origin, part, frame)
+        bool run_started = false;
+        std::string run_origin;
+        uint32_t next_part = 0;
+        uint32_t next_frame = 0;
         std::chrono::steady_clock::time_point created_at;
         std::chrono::steady_clock::time_point last_access;  // Track last access for timeout
-        std::mutex mutex;
-        std::condition_variable cv;  // For blocking GetNext
+        bool erased = false;  // removed from the table; callers still holding it treat it as gone
+        std::mutex mutex;     // guards everything but request_id/created_at (set before publishing)
+        
+        struct ChunkWaiter {
+            uint32_t index;
+            uint64_t byte_offset;
+            mini2::NextChunkResp* resp;
+            const void* id;
+            ChunkCallback done;
+            std::chrono::steady_clock::time_point deadline;
+        };
+        std::vector<ChunkWaiter> waiters;  // parked GetNext calls
     };
+    using Completions = std::vector<std::function<void()>>;  // run after locks are released
     
-    std::map<std::string, Session> sessions_;
-    std::mutex sessions_mutex_;
+    struct Shard {
+        std::shared_mutex mutex;  // shared for lookups, exclusive for insert/erase
+        std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+    };
+    
+    SessionConfig config_;
+    ChunkStore chunk_store_;  // declared first: outlives the sessions holding its entries
+    std::vector<Shard> shards_;
+    
+    Shard& ShardFor(const std::string& session_id);
+    
+    // Returns the session with its mutex held in `lock`, or nullptr if it does not
+    // exist or was erased meanwhile
+    std::shared_ptr<Session> Acquire(const std::string& session_id, std::unique_lock<std::mutex>& lock);
+    
+    // Erases every session for which `expired` holds (checked under its mutex);
+    // their parked GetNext calls are answered via `released`. Returns the count.
+    size_t EraseSessions(const std::function<bool(const Session&)>& expired, const char* reason,
+                         Completions& released);
     
     // Cleanup thread management
     std::thread cleanup_thread_;
-    bool cleanup_running_ = false;
-    std::chrono::seconds session_timeout_{300};  // 5 minutes default
+    std::atomic<bool> cleanup_running_{false};
+    std::chrono::seconds session_timeout_;  // idle time before a session is dropped (resume grace)
     
     // Generate unique session ID
     std::string GenerateSessionId();
@@ -68,4 +182,30 @@ private:
     
     // Clean up stale sessions (called by cleanup thread)
     void CleanupStaleSessions();
+    
+    // Parked GetNext handling; called with the session's mutex held. FillChunk sets
+    // request_id/has_more and picks the chunk; its payload is copied in by Deliver()
+    // after the locks are released, as it may come from disk.
+    struct ChunkReply {
+        ChunkStore::Ref chunk;
+        ChunkOutcome outcome = ChunkOutcome::END;
+        uint64_t byte_offset = 0;
+    };
+    static ChunkReply FillChunk(Session& session, const std::string& session_id, uint32_t index,
+                                uint64_t byte_offset, mini2::NextChunkResp* resp);
+    ChunkOutcome Deliver(const ChunkReply& reply, std::string* out);
+    
+    // Ordered delivery (session mutex held); false if a chunk with the same
+    // (origin, part, frame) is already held, in which case `chunk` is dropped
+    static bool ReleaseInOrder(Session& session, const std::string& origin, uint32_t frame_count,
+                               ChunkStore::Ref chunk);
+    static void FlushHeld(Session& session, const std::string& session_id);
+    
+    // Sliding window: drops chunks more than reread_window behind `cursor`
+    void ReleaseConsumed(Session& session, const std::string& session_id, uint32_t cursor);
+    void ReleaseReadyWaiters(Session& session, const std::string& session_id, Completions& out);
+    static void ReleaseAllWaiters(Session& session, const std::string& session_id, Completions& out);
+    
+    // Answers parked calls that reached the wait limit (called by cleanup thread)
+    void ExpireChunkWaiters();
 };
@@ -0,0 +1,96 @@
+// TaskPlanner.cpp - Decides how many tasks a team request is split into
+// "fixed": workers * tasks_per_worker equal tasks (original behavior)
+// "adaptive": task size driven by target payload bytes, measured rows/sec and dataset size
+
+#include "TaskPlanner.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+uint64_t CeilDiv(uint64_t a, uint64_t b) {
+    return b == 0 ? a : (a + b - 1) / b;
+}
+
+uint64_t AdaptiveRowsPerTask(const TaskSizingConfig& cfg,
+                             uint64_t total_rows,
+                             double avg_row_bytes,
+                             const std::vector<double>& worker_rows_per_sec) {
+    const uint64_t num_workers = std::max<uint64_t>(1, worker_rows_per_sec.size());
+
+    // 1. Payload bound: a task should not produce more than target_task_bytes
+    uint64_t rows_per_task = total_rows;
+    if (avg_row_bytes > 0.0 && cfg.target_task_bytes > 0) {
+        rows_per_task = std::max<uint64_t>(1, static_cast<uint64_t>(cfg.target_task_bytes / avg_row_bytes));
+    }
+
+    // 2. Time bound: use the mean measured throughput of workers that have history
+    double rate_sum = 0.0;
+    size_t rate_count = 0;
+    for (double r : worker_rows_per_sec) {
+        if (r > 0.0) {
+            rate_sum += r;
+            rate_count++;
+        }
+    }
+    if (rate_count > 0 && cfg.target_task_ms > 0) {
+        double mean_rate = rate_sum / static_cast<double>(rate_count);
+        uint64_t time_rows = static_cast<uint64_t>(mean_rate * cfg.target_task_ms / 1000.0);
+        rows_per_task = std::min(rows_per_task, std::max<uint64_t>(1, time_rows));
+    }
+
+    // 3. Parallelism: every worker should get at least min_tasks_per_worker tasks
+    if (cfg.min_tasks_per_worker > 0) {
+        rows_per_task = std::min(rows_per_task,
+                                 CeilDiv(total_rows, num_workers * cfg.min_tasks_per_worker));
+    }
+
+    // 4. Small datasets: tiny tasks are dominated by RPC overhead
+    rows_per_task = std::max(rows_per_task, cfg.min_task_rows);
+
+    // 5. Never exceed max_tasks for one request
+    if (cfg.max_tasks > 0) {
+        rows_per_task = std::max(rows_per_task, CeilDiv(total_rows, cfg.max_tasks));
+    }
+
+    return std::max<uint64_t>(1, std::min(rows_per_task, total_rows));
+}
+}
+
+std::vector<TaskRange> PlanTaskRanges(const TaskSizingConfig& cfg,
+                                      uint64_t total_rows,
+                                      double avg_row_bytes,
+                                      const std::vector<double>& worker_rows_per_sec) {
+    std::vector<TaskRange> ranges;
+    if (total_rows == 0) {
+        return ranges;
+    }
+
+    uint64_t rows_per_task;
+    if (cfg.policy == "fixed") {
+        const uint64_t num_workers = std::max<uint64_t>(1, worker_rows_per_sec.size());
+        const uint64_t num_tasks = num_workers * std::max<uint32_t>(1, cfg.tasks_per_worker);
+        rows_per_task = CeilDiv(total_rows, num_tasks);
+    } else {
+        rows_per_task = AdaptiveRowsPerTask(cfg, total_rows, avg_row_bytes, worker_rows_per_sec);
+    }
+
+    for (uint64_t start = 0; start < total_rows; start += rows_per_task) {
+        TaskRange r;
+        r.start_row = start;
+        r.num_rows = std::min(rows_per_task, total_rows - start);
+        ranges.push_back(r);
+    }
+    return ranges;
+}
+
+std::string DescribePlan(const std::vector<TaskRange>& ranges) {
+    std::ostringstream oss;
+    oss << ranges.size() << " task(s)";
+    if (!ranges.empty()) {
+        oss << ", rows_per_task=" << ranges.front().num_rows;
+        if (ranges.size() > 1 && ranges.back().num_rows != ranges.front().num_rows) {
+            oss << " (last=" << ranges.back().num_rows << ")";
+        }
+    }
+    return oss.str();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../common/config.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One contiguous row range handed to a worker as a Task
+struct TaskRange {
+    uint64_t start_row = 0;
+    uint64_t num_rows  = 0;
+};
+
+// Split total_rows into task ranges according to the task sizing policy.
+//   avg_row_bytes       - average serialized size of one row (0 = unknown)
+//   worker_rows_per_sec - measured throughput of each healthy worker (0 = no history yet)
+std::vector<TaskRange> PlanTaskRanges(const TaskSizingConfig& cfg,
+                                      uint64_t total_rows,
+                                      double avg_row_bytes,
+                                      const std::vector<double>& worker_rows_per_sec);
+
+// Human readable one-liner for logs
+std::string DescribePlan(const std::vector<TaskRange>& ranges);
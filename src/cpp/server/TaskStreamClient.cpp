@@ -0,0 +1,158 @@
+// TaskStreamClient.cpp - Worker end of the credit-based task stream (C, D, F)
+// Reader thread fills buffered_, Next() hands tasks to the executor and tops the window up
+
+#include "TaskStreamClient.h"
+#include "Priority.h"
+#include "../common/logging.h"
+#include <algorithm>
+
+namespace {
+// Delay before re-opening a stream that failed (team leader down or restarting)
+constexpr std::chrono::milliseconds kReconnectDelay{1000};
+}
+
+TaskStreamClient::TaskStreamClient(const std::string& worker_id,
+                                   std::shared_ptr<mini2::TeamIngress::Stub> stub,
+                                   uint32_t window)
+    : worker_id_(worker_id)
+    , stub_(std::move(stub))
+    , window_(std::max<uint32_t>(1, window)) {}
+
+TaskStreamClient::~TaskStreamClient() {
+    Stop();
+}
+
+void TaskStreamClient::Stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopped_) return;
+    stopped_ = true;
+    if (stream_) {
+        CloseStream(lock);
+    }
+    cv_.notify_all();
+}
+
+size_t TaskStreamClient::Buffered() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buffered_.size();
+}
+
+bool TaskStreamClient::Next(mini2::Task& out_task, std::chrono::milliseconds wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopped_) return false;
+    
+    if (stream_ && stream_broken_) {
+        CloseStream(lock);
+    }
+    
+    if (!stream_ && buffered_.empty() && !EnsureStream()) {
+        // Stream unavailable: behave like the old polling loop until it comes back
+        lock.unlock();
+        if (PollOnce(out_task)) {
+            idle_polls_ = 0;
+            return true;
+        }
+        idle_polls_++;
+        auto backoff = std::chrono::milliseconds(std::min(5 * (1 << std::min(idle_polls_ - 1, 6)), 200));
+        std::this_thread::sleep_for(std::min(backoff, wait));
+        return false;
+    }
+    
+    // Top the credit window back up for tasks handed out since the last call
+    uint32_t held = outstanding_ + static_cast<uint32_t>(buffered_.size());
+    if (stream_ && !stream_broken_ && held < window_) {
+        mini2::TaskCredit credit;
+        credit.set_worker_id(worker_id_);
+        credit.set_credits(window_ - held);
+        if (stream_->Write(credit)) {
+            outstanding_ += credit.credits();
+        } else {
+            stream_broken_ = true;
+        }
+    }
+    
+    cv_.wait_for(lock, wait, [this]() { return !buffered_.empty() || stream_broken_ || stopped_; });
+    if (buffered_.empty()) {
+        return false;
+    }
+    out_task = std::move(buffered_.front());
+    buffered_.pop_front();
+    return true;
+}
+
+bool TaskStreamClient::EnsureStream() {
+    // Called with mutex_ held
+    auto now = std::chrono::steady_clock::now();
+    if (closing_ || now < next_connect_attempt_) return false;
+    
+    ctx_ = std::make_unique<grpc::ClientContext>();
+    stream_ = stub_->StreamTasks(ctx_.get());
+    stream_broken_ = false;
+    outstanding_ = 0;
+    
+    mini2::TaskCredit hello;
+    hello.set_worker_id(worker_id_);
+    hello.set_credits(window_ - std::min<uint32_t>(window_, static_cast<uint32_t>(buffered_.size())));
+    bool ok = stream_->Write(hello);
+    if (ok) {
+        outstanding_ = hello.credits();
+    } else {
+        stream_broken_ = true;
+    }
+    
+    // The reader also runs on a failed stream so CloseStream can always join it
+    reader_ = std::thread(&TaskStreamClient::ReaderLoop, this, stream_.get());
+    if (ok) {
+        LOG_INFO(worker_id_, "TaskStream", "Opened task stream (window=" + std::to_string(window_) + ")");
+    }
+    return ok;
+}
+
+void TaskStreamClient::CloseStream(std::unique_lock<std::mutex>& lock) {
+    // Called with mutex_ held via `lock`; released while joining the reader. The stream
+    // is taken out first, so a Stop() or Next() meanwhile finds nothing left to close.
+    ctx_->TryCancel();
+    std::thread reader = std::move(reader_);
+    auto stream = std::move(stream_);
+    auto ctx = std::move(ctx_);
+    stream_broken_ = false;
+    outstanding_ = 0;
+    closing_ = true;  // no new stream until this one is finished
+    lock.unlock();
+    if (reader.joinable()) reader.join();
+    grpc::Status status = stream->Finish();
+    lock.lock();
+    closing_ = false;
+    
+    if (!stopped_) {
+        LOG_WARN(worker_id_, "TaskStream", 
+                 "Task stream closed (" + status.error_message() + "); polling until it reconnects");
+    }
+    next_connect_attempt_ = std::chrono::steady_clock::now() + kReconnectDelay;
+}
+
+void TaskStreamClient::ReaderLoop(grpc::ClientReaderWriter<mini2::TaskCredit, mini2::Task>* stream) {
+    mini2::Task task;
+    while (stream->Read(&task)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        InsertTask(buffered_, std::move(task));
+        if (outstanding_ > 0) outstanding_--;
+        cv_.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream == stream_.get()) stream_broken_ = true;  // not if already closed
+    cv_.notify_all();
+}
+
+bool TaskStreamClient::PollOnce(mini2::Task& out_task) {
+    mini2::NodeId req;
+    req.set_id(worker_id_);
+    grpc::ClientContext ctx;
+    ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(2));
+    grpc::Status status = stub_->RequestTask(&ctx, req, &out_task);
+    if (!status.ok()) {
+        LOG_DEBUG(worker_id_, "TaskStream", "RequestTask failed: " + status.error_message());
+        return false;
+    }
+    return !out_task.request_id().empty();
+}
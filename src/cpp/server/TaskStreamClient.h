@@ -0,0 +1,50 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include "minitwo.grpc.pb.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Worker side of TeamIngress.StreamTasks. The team leader pushes tasks as soon as
+// they are queued, never more than the credit window the worker advertised.
+// Falls back to RequestTask polling while the stream is down.
+class TaskStreamClient {
+public:
+    TaskStreamClient(const std::string& worker_id,
+                     std::shared_ptr<mini2::TeamIngress::Stub> stub,
+                     uint32_t window);
+    ~TaskStreamClient();
+
+    // Waits up to `wait` for the next task; false if none arrived
+    bool Next(mini2::Task& out_task, std::chrono::milliseconds wait);
+    void Stop();
+    size_t Buffered();  // pushed tasks not yet taken by Next()
+
+private:
+    bool EnsureStream();                  // called with mutex_ held
+    void CloseStream(std::unique_lock<std::mutex>& lock);
+    void ReaderLoop(grpc::ClientReaderWriter<mini2::TaskCredit, mini2::Task>* stream);
+    bool PollOnce(mini2::Task& out_task); // unary RequestTask fallback
+
+    std::string worker_id_;
+    std::shared_ptr<mini2::TeamIngress::Stub> stub_;
+    uint32_t window_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unique_ptr<grpc::ClientContext> ctx_;
+    std::unique_ptr<grpc::ClientReaderWriter<mini2::TaskCredit, mini2::Task>> stream_;
+    std::thread reader_;
+    bool stream_broken_ = false;
+    bool closing_ = false;      // CloseStream is finishing the previous stream
+    bool stopped_ = false;
+    uint32_t outstanding_ = 0;  // credits granted but not yet used by the team leader
+    std::deque<mini2::Task> buffered_;  // priority/deadline order
+    std::chrono::steady_clock::time_point next_connect_attempt_;
+    int idle_polls_ = 0;
+};
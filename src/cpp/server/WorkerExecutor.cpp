@@ -0,0 +1,195 @@
+// WorkerExecutor.cpp - Prefetching, multi-threaded task execution for workers (C, D, F)
+// fetch thread -> prefetched_ -> compute threads -> uploads_ -> upload threads
+
+#include "WorkerExecutor.h"
+#include "Priority.h"
+#include "../common/logging.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+// fetch_waits: pause after an empty fetch, so a source that returns at once (a task
+// stream stopped before the executor) does not spin the fetch thread
+constexpr std::chrono::milliseconds kEmptyFetchPause{5};
+}
+
+WorkerExecutor::WorkerExecutor(const std::string& node_id, const Options& options,
+                               FetchFn fetch, ProcessFn process, DeliverFn deliver)
+    : node_id_(node_id)
+    , options_(options)
+    , fetch_(std::move(fetch))
+    , process_(std::move(process))
+    , deliver_(std::move(deliver)) {
+    options_.compute_threads = std::max<size_t>(1, options_.compute_threads);
+    options_.prefetch        = std::max<size_t>(1, options_.prefetch);
+    options_.upload_threads  = std::max<size_t>(1, options_.upload_threads);
+}
+
+WorkerExecutor::~WorkerExecutor() {
+    Stop();
+}
+
+size_t WorkerExecutor::DefaultComputeThreads(int capacity_score) {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    return std::min<size_t>(cores, std::max(1, capacity_score));
+}
+
+void WorkerExecutor::Start() {
+    LOG_INFO(node_id_, "WorkerExecutor", 
+             "Starting with compute_threads=" + std::to_string(options_.compute_threads) +
+             " prefetch=" + std::to_string(options_.prefetch) +
+             " upload_threads=" + std::to_string(options_.upload_threads));
+    
+    compute_alive_ = options_.compute_threads;
+    fetch_thread_ = std::thread(&WorkerExecutor::FetchLoop, this);
+    for (size_t i = 0; i < options_.compute_threads; ++i) {
+        compute_threads_.emplace_back(&WorkerExecutor::ComputeLoop, this);
+    }
+    for (size_t i = 0; i < options_.upload_threads; ++i) {
+        upload_threads_.emplace_back(&WorkerExecutor::UploadLoop, this);
+    }
+}
+
+void WorkerExecutor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    fetch_cv_.notify_all();
+    compute_cv_.notify_all();
+    upload_cv_.notify_all();
+    
+    if (fetch_thread_.joinable()) fetch_thread_.join();
+    for (auto& t : compute_threads_) if (t.joinable()) t.join();
+    for (auto& t : upload_threads_) if (t.joinable()) t.join();
+    
+    LOG_INFO(node_id_, "WorkerExecutor", "Stopped");
+}
+
+size_t WorkerExecutor::QueueDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return prefetched_.size() + running_ + uploads_.size();
+}
+
+void WorkerExecutor::FetchLoop() {
+    // Idle backoff state
+    int idle_iters = 0;
+    int log_counter = 0;
+    const int LOG_EVERY_N = 50;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            fetch_cv_.wait(lock, [this]() {
+                return stopping_ || prefetched_.size() < options_.prefetch;
+            });
+            if (stopping_) break;
+        }
+        
+        mini2::Task task;
+        if (fetch_(task)) {
+            LOG_DEBUG(node_id_, "WorkerExecutor", 
+                      "Prefetched task " + task.request_id() + "." + std::to_string(task.chunk_id()));
+            idle_iters = 0;
+            log_counter = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                InsertTask(prefetched_, std::move(task));
+            }
+            compute_cv_.notify_one();
+            continue;
+        }
+        
+        if (options_.fetch_waits) {
+            // The fetch function normally waited already (streaming dispatch)
+            std::unique_lock<std::mutex> lock(mutex_);
+            fetch_cv_.wait_for(lock, kEmptyFetchPause, [this]() { return stopping_; });
+            if (stopping_) break;
+            continue;
+        }
+        
+        // No task available, use exponential backoff
+        idle_iters++;
+        log_counter++;
+        if (log_counter % LOG_EVERY_N == 1) {
+            LOG_DEBUG(node_id_, "WorkerExecutor", "No tasks available (logged once per " + 
+                      std::to_string(LOG_EVERY_N) + " checks)");
+        }
+        
+        // Exponential backoff: 5ms, 10ms, 20ms, 40ms, 80ms, 160ms, 200ms (cap)
+        int backoff_ms = std::min(5 * (1 << std::min(idle_iters - 1, 6)), 200);
+        std::unique_lock<std::mutex> lock(mutex_);
+        fetch_cv_.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this]() { return stopping_; });
+        if (stopping_) break;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fetch_done_ = true;
+    }
+    compute_cv_.notify_all();
+}
+
+void WorkerExecutor::ComputeLoop() {
+    // Upload queue is bounded so fast compute cannot pile up finished payloads
+    const size_t max_uploads = options_.compute_threads + options_.upload_threads;
+    
+    while (true) {
+        mini2::Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            compute_cv_.wait(lock, [this]() { return !prefetched_.empty() || fetch_done_; });
+            if (prefetched_.empty()) break;  // fetcher stopped and nothing left to run
+            task = std::move(prefetched_.front());
+            prefetched_.pop_front();
+            running_++;
+        }
+        fetch_cv_.notify_one();
+        
+        double processing_ms = 0.0;
+        mini2::WorkerResult result = process_(task, processing_ms);
+        last_task_ms_.store(processing_ms);
+        if (processing_ms > 0.0) {
+            last_rows_per_sec_.store(task.num_rows() * 1000.0 / processing_ms);
+        }
+        
+        LOG_DEBUG(node_id_, "WorkerExecutor", 
+                  "Finished task " + task.request_id() + "." + std::to_string(task.chunk_id()) + 
+                  " in " + std::to_string(processing_ms) + "ms");
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            upload_cv_.wait(lock, [&]() { return uploads_.size() < max_uploads; });
+            running_--;
+            uploads_.emplace_back(std::move(task), std::move(result));
+        }
+        upload_cv_.notify_all();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        compute_alive_--;
+    }
+    upload_cv_.notify_all();
+}
+
+void WorkerExecutor::UploadLoop() {
+    while (true) {
+        std::pair<mini2::Task, mini2::WorkerResult> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            upload_cv_.wait(lock, [this]() { return !uploads_.empty() || compute_alive_ == 0; });
+            if (uploads_.empty()) break;  // compute finished and everything is sent
+            item = std::move(uploads_.front());
+            uploads_.pop_front();
+        }
+        upload_cv_.notify_all();  // frees a slot for compute threads
+        
+        if (!deliver_(item.first, item.second)) {
+            LOG_ERROR(node_id_, "WorkerExecutor", 
+                      "Failed to deliver result for " + item.first.request_id() + "." + 
+                      std::to_string(item.first.chunk_id()));
+        }
+    }
+}
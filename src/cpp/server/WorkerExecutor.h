@@ -0,0 +1,74 @@
+#pragma once
+
+#include "minitwo.grpc.pb.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Worker-side task pipeline: one fetch thread keeps up to `prefetch` tasks queued,
+// `compute_threads` process them in parallel and `upload_threads` push results,
+// so fetching, compute and upload overlap instead of running back to back.
+class WorkerExecutor {
+public:
+    using FetchFn   = std::function<bool(mini2::Task& out_task)>;  // false = no task right now
+    using ProcessFn = std::function<mini2::WorkerResult(const mini2::Task& task, double& processing_ms)>;
+    using DeliverFn = std::function<bool(const mini2::Task& task, const mini2::WorkerResult& result)>;
+
+    struct Options {
+        size_t compute_threads = 1;
+        size_t prefetch        = 1;  // tasks fetched ahead of the compute threads
+        size_t upload_threads  = 1;
+        bool   fetch_waits     = false;  // fetch blocks until work arrives itself, skip idle backoff
+    };
+
+    WorkerExecutor(const std::string& node_id, const Options& options,
+                   FetchFn fetch, ProcessFn process, DeliverFn deliver);
+    ~WorkerExecutor();
+
+    void Start();
+    void Stop();  // finishes tasks already fetched, then joins all threads
+
+    // Prefetched + running + waiting-for-upload tasks (reported as heartbeat queue_len)
+    size_t QueueDepth() const;
+    double LastTaskMs() const { return last_task_ms_.load(); }
+    double LastRowsPerSec() const { return last_rows_per_sec_.load(); }
+
+    // Threads to use when config leaves it to us: capacity score, capped by core count
+    static size_t DefaultComputeThreads(int capacity_score);
+
+private:
+    void FetchLoop();
+    void ComputeLoop();
+    void UploadLoop();
+
+    std::string node_id_;
+    Options options_;
+    FetchFn fetch_;
+    ProcessFn process_;
+    DeliverFn deliver_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable fetch_cv_;    // prefetch slot freed
+    std::condition_variable compute_cv_;  // task fetched
+    std::condition_variable upload_cv_;   // result ready / upload slot freed
+    std::deque<mini2::Task> prefetched_;  // priority/deadline order
+    std::deque<std::pair<mini2::Task, mini2::WorkerResult>> uploads_;
+    size_t running_ = 0;
+    bool stopping_ = false;
+    bool fetch_done_ = false;
+    size_t compute_alive_ = 0;
+
+    std::atomic<double> last_task_ms_{0.0};
+    std::atomic<double> last_rows_per_sec_{0.0};
+
+    std::thread fetch_thread_;
+    std::vector<std::thread> compute_threads_;
+    std::vector<std::thread> upload_threads_;
+};
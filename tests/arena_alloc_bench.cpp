@@ -0,0 +1,254 @@
+// malloc calls per RPC on the task dispatch and result push paths, with the messages
+// gRPC's default holder would give a unary callback handler (plain heap-backed members)
+// versus ArenaMessageAllocator. Each "call" is what the server does for one RPC:
+// parse the request off the wire, run the handler body, serialize the response.
+
+#include <atomic>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include "../src/cpp/server/ArenaMessageAllocator.h"
+#include "minitwo.pb.h"
+#include "test_check.h"
+
+namespace {
+
+std::atomic<bool> g_counting{false};
+std::atomic<long> g_mallocs{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    if (g_counting) g_mallocs++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+// Out of line: inlined into a caller, GCC pairs free() with that caller's new
+// expression and warns (-Wmismatched-new-delete)
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr int kCalls = 20000;
+
+// Stands in for gRPC's DefaultMessageHolder: messages are plain members
+template <typename Req, typename Resp>
+struct HeapHolder {
+    Req req;
+    Resp resp;
+    Req* request() { return &req; }
+    Resp* response() { return &resp; }
+};
+
+std::string WireTaskComplete() {
+    mini2::TaskComplete notice;
+    notice.set_request_id("session-1718000000000-4821");
+    notice.set_chunk_id(17);
+    notice.set_worker_id("worker-C");
+    notice.set_payload_bytes(1 << 20);
+    notice.set_origin("team-leader-B");
+    return notice.SerializeAsString();
+}
+
+std::string WireWorkerResult(size_t payload_bytes) {
+    mini2::WorkerResult result;
+    result.set_request_id("session-1718000000000-4821");
+    result.set_part_index(17);
+    result.set_payload(std::string(payload_bytes, 'x'));
+    result.set_origin("team-leader-B");
+    result.set_worker_id("worker-C");
+    return result.SerializeAsString();
+}
+
+std::string WireNodeId() {
+    mini2::NodeId id;
+    id.set_id("worker-C");
+    return id.SerializeAsString();
+}
+
+// What a team leader has queued for a worker: tasks built before the measurement,
+// as they are when HandleTeamRequest plans them
+std::deque<mini2::Task> QueuedTasks() {
+    std::deque<mini2::Task> queue;
+    for (int i = 0; i < kCalls; ++i) {
+        mini2::Task task;
+        task.set_request_id("session-1718000000000-4821");
+        task.set_session_id("session-1718000000000-4821");
+        task.set_chunk_id(static_cast<uint32_t>(i));
+        task.set_start_row(static_cast<uint64_t>(i) * 50000);
+        task.set_num_rows(50000);
+        task.set_dataset_path("test_data/data_10k.csv");
+        task.set_result_sink("localhost:50050");
+        task.set_origin("team-leader-B");
+        queue.push_back(std::move(task));
+    }
+    return queue;
+}
+
+std::string WireHeartbeat() {
+    mini2::Heartbeat hb;
+    hb.set_from("worker-C");
+    hb.set_ts_unix_ms(1718000000000);
+    hb.set_recent_task_ms(12.5);
+    hb.set_queue_len(3);
+    hb.set_capacity_score(2);
+    return hb.SerializeAsString();
+}
+
+// One unary call: parse, handler body, serialize the response into a reused buffer
+template <typename Holder, typename Body>
+void Call(Holder* holder, const std::string& wire, Body body, std::string& out) {
+    CHECK(holder->request()->ParseFromString(wire));
+    body(*holder->request(), holder->response());
+    holder->response()->SerializeToString(&out);
+}
+
+template <typename Req, typename Resp, typename Body>
+double HeapPerCall(const std::string& wire, Body body) {
+    std::string out;
+    out.reserve(1024);
+    g_mallocs = 0;
+    g_counting = true;
+    for (int i = 0; i < kCalls; ++i) {
+        HeapHolder<Req, Resp> holder;  // gRPC places this in its call arena, not on the heap
+        Call(&holder, wire, body, out);
+    }
+    g_counting = false;
+    return static_cast<double>(g_mallocs) / kCalls;
+}
+
+template <typename Req, typename Resp, typename Body>
+double ArenaPerCall(const std::string& wire, Body body) {
+    ArenaMessageAllocator<Req, Resp> allocator;
+    std::string out;
+    out.reserve(1024);
+    allocator.AllocateMessages()->Release();  // first holder is created once per server, not per call
+    g_mallocs = 0;
+    g_counting = true;
+    for (int i = 0; i < kCalls; ++i) {
+        auto* holder = allocator.AllocateMessages();
+        Call(holder, wire, body, out);
+        holder->Release();
+    }
+    g_counting = false;
+    return static_cast<double>(g_mallocs) / kCalls;
+}
+
+// Worker side of the direct data path: the completion notice built per task
+template <typename Fill>
+double NoticePerSend(bool arena, Fill fill) {
+    std::string out;
+    out.reserve(1024);
+    g_mallocs = 0;
+    g_counting = true;
+    for (int i = 0; i < kCalls; ++i) {
+        if (arena) {
+            InlineArena<1024> scratch;
+            auto* notice = google::protobuf::Arena::CreateMessage<mini2::TaskComplete>(scratch.get());
+            fill(notice);
+            notice->SerializeToString(&out);
+        } else {
+            mini2::TaskComplete notice;
+            fill(&notice);
+            notice.SerializeToString(&out);
+        }
+    }
+    g_counting = false;
+    return static_cast<double>(g_mallocs) / kCalls;
+}
+
+struct Row {
+    const char* name;
+    double heap;
+    double arena;
+    bool arena_in_server = true;  // false: the server keeps gRPC's default holder here
+};
+
+void Print(const Row& row) {
+    std::cout << std::left << std::setw(34) << row.name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(8) << row.heap << std::setw(8) << row.arena
+              << std::setw(9) << (row.heap > 0 ? 100.0 * (row.heap - row.arena) / row.heap : 0.0) << "%"
+              << (row.arena_in_server ? "" : "  (server uses heap)") << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    // Handler bodies: what the server keeps is copied out (as RequestProcessor does)
+    auto ack = [](const auto&, mini2::HeartbeatAck* resp) { resp->set_ok(true); };
+    mini2::WorkerResult stored;
+    auto store_result = [&stored](const mini2::WorkerResult& req, mini2::HeartbeatAck* resp) {
+        stored = req;
+        resp->set_ok(true);
+    };
+
+    const std::string notice = WireTaskComplete();
+    const std::string request_id = "session-1718000000000-4821";
+    auto fill_notice = [&request_id](mini2::TaskComplete* n) {
+        n->set_request_id(request_id);
+        n->set_chunk_id(17);
+        n->set_worker_id("worker-C");
+        n->set_payload_bytes(1 << 20);
+        n->set_origin("team-leader-B");
+    };
+    const std::string small_result = WireWorkerResult(4 * 1024);
+    const std::string chunk(64 * 1024, 'y');
+    auto serve_chunk = [&chunk](const mini2::NextChunkReq& req, mini2::NextChunkResp* resp) {
+        resp->set_request_id(req.request_id());  // as SessionManager::FillChunk does
+        resp->set_chunk(chunk);
+        resp->set_has_more(true);
+    };
+    mini2::NextChunkReq next;
+    next.set_request_id(request_id);
+    next.set_next_index(3);
+    const std::string next_wire = next.SerializeAsString();
+    const std::string heartbeat = WireHeartbeat();
+    
+    // Task dispatch: RequestTask moves the worker's next task out of its queue
+    const std::string node_id = WireNodeId();
+    std::deque<mini2::Task> queue;
+    auto dispatch = [&queue](const mini2::NodeId&, mini2::Task* resp) {
+        *resp = std::move(queue.front());  // a copy when resp lives on an arena
+        queue.pop_front();
+    };
+
+    Row rows[] = {
+        {"RequestTask (task dispatch)",
+         [&] { queue = QueuedTasks(); return HeapPerCall<mini2::NodeId, mini2::Task>(node_id, dispatch); }(),
+         [&] { queue = QueuedTasks(); return ArenaPerCall<mini2::NodeId, mini2::Task>(node_id, dispatch); }(),
+         false},
+        {"ReportTaskComplete (completion)",
+         HeapPerCall<mini2::TaskComplete, mini2::HeartbeatAck>(notice, ack),
+         ArenaPerCall<mini2::TaskComplete, mini2::HeartbeatAck>(notice, ack)},
+        {"TaskComplete send (worker)",
+         NoticePerSend(false, fill_notice),
+         NoticePerSend(true, fill_notice)},
+        {"Ping (worker heartbeat)",
+         HeapPerCall<mini2::Heartbeat, mini2::HeartbeatAck>(heartbeat, ack),
+         ArenaPerCall<mini2::Heartbeat, mini2::HeartbeatAck>(heartbeat, ack)},
+        {"PushWorkerResult (4 KB payload)",
+         HeapPerCall<mini2::WorkerResult, mini2::HeartbeatAck>(small_result, store_result),
+         ArenaPerCall<mini2::WorkerResult, mini2::HeartbeatAck>(small_result, store_result)},
+        {"GetNext (64 KB chunk)",
+         HeapPerCall<mini2::NextChunkReq, mini2::NextChunkResp>(next_wire, serve_chunk),
+         ArenaPerCall<mini2::NextChunkReq, mini2::NextChunkResp>(next_wire, serve_chunk)},
+    };
+
+    std::cout << std::left << std::setw(34) << "mallocs per call" << std::right
+              << std::setw(8) << "heap" << std::setw(8) << "arena" << std::setw(10) << "saved" << std::endl;
+    for (const auto& row : rows) Print(row);
+
+    // The arena must save allocations wherever the server uses it. Dispatch stays on
+    // the heap: moving a queued Task into an arena response copies it instead.
+    for (const auto& row : rows) {
+        if (row.arena_in_server) CHECK(row.arena < row.heap);
+        else CHECK(row.heap <= row.arena);
+    }
+
+    std::cout << "arena_alloc_bench passed" << std::endl;
+    return 0;
+}
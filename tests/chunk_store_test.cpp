@@ -0,0 +1,108 @@
+// Gateway memory under a chunk store budget: two coalesced sessions share one result
+// set, which is counted once and kept in memory while the request still holds it.
+// Once the request lets go, trimming spills down to the budget and the heap actually
+// shrinks by the spilled payloads; the spilled chunks read back intact.
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../src/cpp/server/SessionManager.h"
+#include "test_check.h"
+
+namespace {
+
+constexpr size_t kPayloadBytes = 4 * 1024 * 1024;
+constexpr uint32_t kParts = 6;
+constexpr uint64_t kBudgetBytes = 2 * kPayloadBytes;
+
+std::atomic<long long> g_live_bytes{0};
+
+}  // namespace
+
+// Live heap bytes, as the allocator hands them out
+void* operator new(size_t size) {
+    if (void* p = std::malloc(size ? size : 1)) {
+        g_live_bytes += static_cast<long long>(malloc_usable_size(p));
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    if (p) g_live_bytes -= static_cast<long long>(malloc_usable_size(p));
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+int main() {
+    SessionConfig session_config;
+    session_config.sliding_window = false;
+    ChunkStoreConfig store_config;
+    store_config.memory_budget_bytes = kBudgetBytes;
+    store_config.spill_dir = "/tmp/mini2-chunk-store-test-" + std::to_string(::getpid());
+    SessionManager sessions(session_config, store_config);
+
+    // What ProcessRequest hands the gateway: one buffer per part
+    std::vector<SessionManager::Chunk> parts;
+    for (uint32_t i = 0; i < kParts; ++i) {
+        auto r = std::make_shared<mini2::WorkerResult>();
+        r->set_part_index(i);
+        r->set_worker_id("C");
+        r->set_payload(std::string(kPayloadBytes, static_cast<char>('a' + i)));
+        parts.push_back(std::move(r));
+    }
+    auto results = std::make_shared<const std::vector<SessionManager::Chunk>>(std::move(parts));
+
+    std::vector<std::string> session_ids;
+    for (int s = 0; s < 2; ++s) {  // leader session plus one coalesced rider
+        mini2::Request open;
+        open.set_delivery(mini2::DELIVERY_UNORDERED);
+        std::string sid = sessions.CreateSession(open);
+        sessions.AddChunks(sid, results);
+        sessions.CompleteSession(sid);
+        session_ids.push_back(sid);
+    }
+
+    // Shared buffers count once, and none is spilled while the request still holds it
+    auto held = sessions.GetChunkStoreStats();
+    std::cout << "while held: memory=" << held.memory_bytes << " spilled=" << held.spilled_chunks << std::endl;
+    CHECK(held.memory_bytes == kParts * kPayloadBytes);
+    CHECK(held.memory_chunks == kParts);
+    CHECK(held.spilled_chunks == 0);
+
+    // The request lets go; trimming must give the heap back, not just the counter
+    const long long before = g_live_bytes;
+    results.reset();
+    sessions.TrimChunks();
+    const long long after = g_live_bytes;
+    auto trimmed = sessions.GetChunkStoreStats();
+    const long long freed = before - after;
+    std::cout << "after trim: memory=" << trimmed.memory_bytes << " spilled=" << trimmed.spilled_chunks
+              << " heap freed=" << freed << " bytes" << std::endl;
+    CHECK(trimmed.memory_bytes <= kBudgetBytes);
+    CHECK(trimmed.spilled_chunks == kParts - kBudgetBytes / kPayloadBytes);
+    CHECK(freed >= static_cast<long long>(trimmed.spilled_chunks * kPayloadBytes));
+
+    // Both sessions read every part back intact, spilled or not
+    for (const auto& sid : session_ids) {
+        for (uint32_t i = 0; i < kParts; ++i) {
+            mini2::PollResp resp;
+            bool ok = sessions.PollNextChunk(sid, &resp);
+            CHECK(ok && resp.ready());
+            CHECK(resp.chunk() == std::string(kPayloadBytes, static_cast<char>('a' + resp.part_index())));
+        }
+    }
+
+    for (const auto& sid : session_ids) sessions.CleanupSession(sid);
+    auto released = sessions.GetChunkStoreStats();
+    CHECK(released.memory_bytes == 0 && released.spilled_chunks == 0);
+    std::filesystem::remove_all(store_config.spill_dir);
+    std::cout << "chunk_store_test passed" << std::endl;
+    return 0;
+}
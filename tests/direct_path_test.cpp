@@ -0,0 +1,132 @@
+// End to end over gRPC on localhost, the direct_to_gateway data path: a worker (C)
+// finishes a task of team leader B's and pushes the payload straight to the gateway
+// (A), framed, while B only gets the completion notice. The result must be stored for
+// the request on A and served to the client's session byte for byte.
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "minitwo.grpc.pb.h"
+#include "../src/cpp/server/RequestProcessor.h"
+#include "../src/cpp/server/SessionManager.h"
+#include "test_check.h"
+
+namespace {
+
+constexpr size_t kPayloadBytes = 256 * 1024;
+constexpr uint64_t kFrameBytes = 64 * 1024;  // the push is streamed as 4 frames
+
+// The result-ingest part of a node's TeamIngress, as the server wires it
+class Ingress final : public mini2::TeamIngress::Service {
+public:
+    explicit Ingress(RequestProcessor& processor) : processor_(processor) {}
+
+    grpc::Status PushWorkerResult(grpc::ServerContext*, const mini2::WorkerResult* req,
+                                  mini2::HeartbeatAck* resp) override {
+        processor_.ReceiveWorkerResult(*req);
+        resp->set_ok(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status UploadWorkerResult(grpc::ServerContext*, grpc::ServerReader<mini2::WorkerResult>* reader,
+                                    mini2::HeartbeatAck* resp) override {
+        mini2::WorkerResult frame;
+        while (reader->Read(&frame)) processor_.ReceiveWorkerResult(std::move(frame));
+        resp->set_ok(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status ReportTaskComplete(grpc::ServerContext*, const mini2::TaskComplete* req,
+                                    mini2::HeartbeatAck* resp) override {
+        notices_++;
+        processor_.ReceiveTaskComplete(*req);
+        resp->set_ok(true);
+        return grpc::Status::OK;
+    }
+
+    int notices() const { return notices_; }
+
+private:
+    RequestProcessor& processor_;
+    std::atomic<int> notices_{0};
+};
+
+struct Node {
+    RequestProcessor processor;
+    Ingress ingress;
+    std::unique_ptr<grpc::Server> server;
+    std::string address;
+
+    explicit Node(const std::string& id) : processor(id), ingress(processor) {
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(&ingress);
+        server = builder.BuildAndStart();
+        address = "127.0.0.1:" + std::to_string(port);
+    }
+    ~Node() { server->Shutdown(); }
+};
+
+}  // namespace
+
+int main() {
+    Node gateway("A");
+    Node leader("B");
+    CHECK(gateway.server && leader.server);
+
+    // Worker C of team B, with payloads above the frame size streamed
+    RequestProcessor worker("C");
+    worker.SetLeaderAddress(leader.address);
+    worker.SetUploadFrameBytes(kFrameBytes);
+
+    // A task as B hands it out with direct_to_gateway on, and C's result for it
+    const std::string request_id = "direct-path";
+    mini2::Task task;
+    task.set_request_id(request_id);
+    task.set_chunk_id(0);
+    task.set_origin("B");
+    task.set_result_sink(gateway.address);
+    mini2::WorkerResult result;
+    result.set_request_id(request_id);
+    result.set_part_index(task.chunk_id());
+    result.set_origin(task.origin());
+    result.set_worker_id("C");
+    std::string payload(kPayloadBytes, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>('a' + i % 26);
+    result.set_payload(payload);
+
+    CHECK(worker.DeliverTaskResult(task, result));
+    CHECK(leader.ingress.notices() == 1);
+
+    // Stored for the request on A...
+    mini2::Request req;
+    req.set_request_id(request_id);
+    auto results = std::make_shared<const std::vector<RequestProcessor::Result>>(
+        gateway.processor.ProcessRequest(req));
+    std::cout << "gateway stored " << results->size() << " frame(s)" << std::endl;
+    CHECK(results->size() == kPayloadBytes / kFrameBytes);
+
+    // ...and served to the session in order, adding up to the payload
+    SessionManager sessions;
+    const std::string sid = sessions.CreateSession(req);
+    sessions.AddChunks(sid, results);
+    sessions.CompleteSession(sid);
+    std::string served;
+    for (uint32_t i = 0; i < results->size(); ++i) {
+        mini2::NextChunkResp resp;
+        bool found = false;
+        sessions.GetNextChunkAsync(sid, i, 0, &resp, &resp, [&found](SessionManager::ChunkOutcome o) {
+            found = o == SessionManager::ChunkOutcome::FOUND;
+        });
+        CHECK(found);
+        served += resp.chunk();
+    }
+    CHECK(served == payload);
+
+    std::cout << "direct_path_test passed" << std::endl;
+    return 0;
+}
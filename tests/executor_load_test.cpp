@@ -0,0 +1,127 @@
+// Bursty load against the gateway request path (AdmissionController + BoundedExecutor):
+// 500 clients arrive at once, several times over. The process thread count must stay
+// at the pool size and resident memory must not grow from burst to burst.
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/cpp/server/AdmissionController.h"
+#include "../src/cpp/server/BoundedExecutor.h"
+#include "test_check.h"
+
+namespace {
+
+// Field from /proc/self/status ("Threads", "VmRSS" in kB); 0 when unavailable
+long ProcStatus(const std::string& field) {
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0) {
+            return std::stol(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main() {
+    constexpr uint32_t kRunning = 8;
+    constexpr uint32_t kQueued = 64;
+    constexpr int kBursts = 6;
+    constexpr int kClientsPerBurst = 500;
+    constexpr int kSubmitters = 4;
+
+    const long base_threads = ProcStatus("Threads");
+
+    // Same wiring as ClientGatewayService
+    BoundedExecutor executor("load", kRunning, kRunning);
+    AdmissionController admission("load", kRunning, kQueued, [&executor](AdmissionController::Job job) {
+        auto shared = std::make_shared<AdmissionController::Job>(std::move(job));
+        if (!executor.TrySubmit([shared]() { (*shared)(); })) (*shared)();
+    });
+
+    std::atomic<long> ran{0};
+    std::atomic<long> peak_threads{0};
+    std::atomic<bool> sampling{true};
+    std::thread sampler([&]() {
+        while (sampling) {
+            long t = ProcStatus("Threads");
+            if (t > peak_threads) peak_threads = t;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    long accepted = 0;
+    long rejected = 0;
+    std::vector<long> rss_after_burst;
+    for (int burst = 0; burst < kBursts; ++burst) {
+        std::atomic<long> burst_accepted{0};
+        std::atomic<long> burst_rejected{0};
+        std::vector<std::thread> submitters;
+        for (int s = 0; s < kSubmitters; ++s) {
+            submitters.emplace_back([&, s]() {
+                for (int c = s; c < kClientsPerBurst; c += kSubmitters) {
+                    std::string session = "b" + std::to_string(burst) + "-c" + std::to_string(c);
+                    auto decision = admission.Submit(session, [&ran]() {
+                        std::vector<char> results(64 * 1024, 'x');  // stands in for the result set
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                        ran += results.size() > 0 ? 1 : 0;
+                    }, ScheduleKey{c % 3, 0});
+                    if (decision.outcome == AdmissionController::Outcome::REJECTED) burst_rejected++;
+                    else burst_accepted++;
+                }
+            });
+        }
+        for (auto& t : submitters) t.join();
+        accepted += burst_accepted;
+        rejected += burst_rejected;
+
+        // Let the burst drain before the next one arrives
+        while (true) {
+            auto stats = admission.GetStats();
+            if (stats.running == 0 && stats.queued == 0) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        rss_after_burst.push_back(ProcStatus("VmRSS"));
+        std::cout << "burst " << burst << ": accepted=" << burst_accepted << " rejected=" << burst_rejected
+                  << " rss_kb=" << rss_after_burst.back() << std::endl;
+    }
+
+    sampling = false;
+    sampler.join();
+    bool drained = executor.Shutdown(std::chrono::seconds(5));
+    auto stats = executor.GetStats();
+
+    std::cout << "threads: base=" << base_threads << " peak=" << peak_threads
+              << " (pool=" << kRunning << ", submitters=" << kSubmitters << ")" << std::endl;
+    std::cout << "executor: completed=" << stats.completed << " max_queued=" << stats.max_queued
+              << " rejected=" << stats.rejected << " avg_wait_ms=" << stats.avg_wait_ms << std::endl;
+
+    // Every admitted request ran exactly once, none were lost in the pool
+    CHECK(drained);
+    CHECK(accepted + rejected == static_cast<long>(kBursts) * kClientsPerBurst);
+    CHECK(ran == accepted);
+    CHECK(stats.completed == static_cast<uint64_t>(accepted));
+    CHECK(stats.rejected == 0);
+    CHECK(stats.max_queued <= kRunning);
+    CHECK(rejected > 0);  // bursts exceed running + queued, so overload must be shed
+
+    // Thread count bounded by the pool, not by the number of clients
+    if (base_threads > 0) {
+        CHECK(peak_threads <= base_threads + kRunning + kSubmitters + 1);
+    }
+
+    // No growth across bursts once the first one warmed up the allocator (2 MB slack)
+    if (rss_after_burst.front() > 0) {
+        CHECK(rss_after_burst.back() - rss_after_burst[1] < 2048);
+    }
+
+    std::cout << "executor_load_test passed" << std::endl;
+    return 0;
+}
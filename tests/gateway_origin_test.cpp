@@ -0,0 +1,82 @@
+// Results reaching the gateway (A) carry the team leader they belong to in `origin`:
+// team leaders forward with their own id, and with direct_to_gateway workers push
+// straight to A with the task's origin. None of those is a peer of A, so every one
+// must be kept for the request and served to its session, not relayed or dropped.
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/cpp/server/RequestProcessor.h"
+#include "../src/cpp/server/SessionManager.h"
+#include "test_check.h"
+
+namespace {
+
+struct Sent {
+    std::string origin;     // team leader the part belongs to
+    std::string worker_id;  // who delivered it
+    bool framed;            // direct path: uploaded in frames
+};
+
+// B relays its own parts; C and F push theirs to A directly (one framed upload)
+const std::vector<Sent> kSent = {
+    {"B", "B", false},
+    {"E", "E", false},
+    {"B", "C", false},
+    {"E", "F", true},
+};
+
+std::string Payload(uint32_t part) { return std::string(1024, static_cast<char>('a' + part)); }
+
+}  // namespace
+
+int main() {
+    RequestProcessor processor("A");
+    SessionManager sessions;
+    const std::string request_id = "origin-tagged";
+
+    for (uint32_t part = 0; part < kSent.size(); ++part) {
+        const Sent& sent = kSent[part];
+        const uint32_t frames = sent.framed ? 2 : 1;
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            mini2::WorkerResult r;
+            r.set_request_id(request_id);
+            r.set_part_index(part);
+            r.set_origin(sent.origin);
+            r.set_worker_id(sent.worker_id);
+            if (sent.framed) {
+                r.set_frame_index(frame);
+                r.set_frame_count(frames);
+            }
+            r.set_payload(Payload(part));
+            processor.ReceiveWorkerResult(std::move(r));
+        }
+    }
+
+    // Everything stored for the request (pending_results_ is what ProcessRequest returns)
+    mini2::Request req;
+    req.set_request_id(request_id);
+    auto results = std::make_shared<const std::vector<RequestProcessor::Result>>(processor.ProcessRequest(req));
+    std::cout << "stored " << results->size() << " result(s)" << std::endl;
+    CHECK(results->size() == kSent.size() + 1);  // the framed part counts once per frame
+
+    // ... and served to the client's session
+    mini2::Request open;
+    open.set_delivery(mini2::DELIVERY_UNORDERED);
+    const std::string sid = sessions.CreateSession(open);
+    sessions.AddChunks(sid, results);
+    sessions.CompleteSession(sid);
+    for (uint32_t i = 0; i < results->size(); ++i) {
+        mini2::NextChunkResp resp;
+        bool found = false;
+        sessions.GetNextChunkAsync(sid, i, 0, &resp, &resp, [&found](SessionManager::ChunkOutcome o) {
+            found = o == SessionManager::ChunkOutcome::FOUND;
+        });
+        CHECK(found);
+        CHECK(resp.chunk() == Payload(resp.part_index()));
+    }
+
+    std::cout << "gateway_origin_test passed" << std::endl;
+    return 0;
+}
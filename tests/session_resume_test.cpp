@@ -0,0 +1,113 @@
+// ResumeSession after a dropped connection: a client reads part of a session through
+// GetNext with the sliding window on, then hands a continuation token back. A token
+// inside the re-read window resumes (also part-way into a chunk); a token below the
+// window, past the chunks sent, or past the end of its chunk is refused.
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/cpp/server/SessionManager.h"
+#include "test_check.h"
+
+namespace {
+
+constexpr uint32_t kChunks = 8;
+constexpr size_t kChunkBytes = 64;
+constexpr uint32_t kReadUpTo = 5;  // client got chunks 0..kReadUpTo before the drop
+
+std::shared_ptr<const std::vector<SessionManager::Chunk>> MakeResults() {
+    auto results = std::make_shared<std::vector<SessionManager::Chunk>>();
+    for (uint32_t i = 0; i < kChunks; ++i) {
+        auto r = std::make_shared<mini2::WorkerResult>();
+        r->set_part_index(i);
+        r->set_payload(std::string(kChunkBytes, static_cast<char>('a' + i)));
+        results->push_back(std::move(r));
+    }
+    return results;
+}
+
+// Chunks are all in, so GetNext answers before returning
+SessionManager::ChunkOutcome GetNext(SessionManager& sessions, const std::string& id, uint32_t index,
+                                     uint64_t byte_offset, mini2::NextChunkResp* resp) {
+    SessionManager::ChunkOutcome outcome = SessionManager::ChunkOutcome::END;
+    bool answered = false;
+    sessions.GetNextChunkAsync(id, index, byte_offset, resp, resp, [&](SessionManager::ChunkOutcome o) {
+        outcome = o;
+        answered = true;
+    });
+    CHECK(answered);
+    return outcome;
+}
+
+mini2::ContinuationToken Token(const std::string& id, uint32_t chunk_index, uint64_t byte_offset) {
+    mini2::ContinuationToken token;
+    token.set_session_id(id);
+    token.set_chunk_index(chunk_index);
+    token.set_byte_offset(byte_offset);
+    return token;
+}
+
+bool Resume(SessionManager& sessions, const mini2::ContinuationToken& token, const char* expect_error) {
+    mini2::ResumeResp resp;
+    bool ok = sessions.ResumeSession(token, &resp);
+    std::cout << "resume chunk " << token.chunk_index() << " byte " << token.byte_offset() << ": "
+              << (ok ? "ok" : resp.error()) << std::endl;
+    CHECK(ok == resp.ok());
+    CHECK(ok || resp.error() == expect_error);
+    return ok;
+}
+
+}  // namespace
+
+int main() {
+    SessionConfig config;
+    config.sliding_window = true;
+    config.reread_window = 2;
+    SessionManager sessions(config);
+
+    mini2::Request req;
+    req.set_delivery(mini2::DELIVERY_UNORDERED);
+    const std::string id = sessions.CreateSession(req);
+    sessions.AddChunks(id, MakeResults());
+    sessions.CompleteSession(id);
+
+    mini2::ContinuationToken last;
+    for (uint32_t i = 0; i <= kReadUpTo; ++i) {
+        mini2::NextChunkResp resp;
+        auto outcome = GetNext(sessions, id, i, 0, &resp);
+        CHECK(outcome == SessionManager::ChunkOutcome::FOUND);
+        CHECK(resp.chunk() == std::string(kChunkBytes, static_cast<char>('a' + i)));
+        last = resp.continuation();
+    }
+    // Asking for kReadUpTo acknowledged everything below it, minus the re-read window
+    const uint32_t released_below = kReadUpTo - config.reread_window;
+
+    // The token the gateway handed out last: next chunk, from its start
+    CHECK(last.session_id() == id && last.chunk_index() == kReadUpTo + 1 && last.byte_offset() == 0);
+    CHECK(Resume(sessions, last, ""));
+
+    // Inside the window, part-way into a chunk: resumes, and GetNext serves the rest
+    CHECK(Resume(sessions, Token(id, released_below, 10), ""));
+    mini2::NextChunkResp rest;
+    auto outcome = GetNext(sessions, id, released_below, 10, &rest);
+    CHECK(outcome == SessionManager::ChunkOutcome::FOUND);
+    CHECK(rest.chunk() == std::string(kChunkBytes - 10, static_cast<char>('a' + released_below)));
+
+    // Below the window: those chunks are gone
+    CHECK(!Resume(sessions, Token(id, released_below - 1, 0), "chunk already released"));
+
+    // Tokens the gateway could not have handed out
+    CHECK(!Resume(sessions, Token(id, kChunks + 1, 0), "chunk index past the session's chunks"));
+    CHECK(!Resume(sessions, Token(id, kReadUpTo, kChunkBytes + 1), "byte offset past the end of the chunk"));
+    CHECK(!Resume(sessions, Token(id, kChunks, 1), "byte offset past the end of the chunk"));
+
+    // Unknown session: refused, and a fetch on it is told so rather than ended quietly
+    CHECK(!Resume(sessions, Token("session-unknown", 0, 0), "session expired or unknown"));
+    mini2::NextChunkResp unknown;
+    CHECK(GetNext(sessions, "session-unknown", 0, 0, &unknown) == SessionManager::ChunkOutcome::NOT_FOUND);
+
+    sessions.CleanupSession(id);
+    std::cout << "session_resume_test passed" << std::endl;
+    return 0;
+}
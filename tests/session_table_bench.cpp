@@ -0,0 +1,137 @@
+// 1,000 client sessions reading their results through GetNext at once, while
+// other sessions are created, filled and erased next to them. Run once with a single
+// session table shard (what one global lock gave) and once with the configured
+// sharding; every GetNext must return its own session's chunk either way.
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/cpp/server/SessionManager.h"
+#include "test_check.h"
+
+namespace {
+
+constexpr int kSessions = 1000;
+constexpr uint32_t kChunks = 64;
+constexpr size_t kChunkBytes = 256;
+
+std::shared_ptr<const std::vector<SessionManager::Chunk>> MakeResults(char tag) {
+    auto results = std::make_shared<std::vector<SessionManager::Chunk>>();
+    for (uint32_t i = 0; i < kChunks; ++i) {
+        auto r = std::make_shared<mini2::WorkerResult>();
+        r->set_part_index(i);
+        r->set_payload(std::string(kChunkBytes, tag));
+        r->mutable_payload()->replace(0, sizeof(i), reinterpret_cast<const char*>(&i), sizeof(i));
+        results->push_back(std::move(r));
+    }
+    return results;
+}
+
+struct RunResult {
+    double seconds;
+    long get_nexts;
+    long churned;
+};
+
+RunResult Run(uint32_t shards, int readers) {
+    SessionConfig config;
+    config.shards = shards;
+    SessionManager sessions(config);
+
+    // Each client session gets its own results; the tag identifies whose chunk came back
+    std::vector<std::string> ids;
+    std::vector<char> tags;
+    for (int s = 0; s < kSessions; ++s) {
+        mini2::Request req;
+        ids.push_back(sessions.CreateSession(req));
+        tags.push_back(static_cast<char>('A' + s % 26));
+        sessions.AddChunks(ids.back(), MakeResults(tags.back()));
+        sessions.CompleteSession(ids.back());
+    }
+
+    std::atomic<bool> reading{true};
+    std::atomic<long> churned{0};
+    std::thread churn([&]() {
+        auto results = MakeResults('z');
+        while (reading) {
+            mini2::Request req;
+            std::string sid = sessions.CreateSession(req);
+            sessions.AddChunks(sid, results);
+            sessions.CompleteSession(sid);
+            sessions.CleanupSession(sid);
+            churned++;
+        }
+    });
+
+    std::atomic<long> get_nexts{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t]() {
+            mini2::NextChunkResp resp;
+            long done = 0;
+            // Clients take turns on a thread, one chunk each, like interleaved GetNext RPCs
+            for (uint32_t index = 0; index < kChunks; ++index) {
+                for (int s = t; s < kSessions; s += readers) {
+                    resp.Clear();
+                    SessionManager::ChunkOutcome outcome = SessionManager::ChunkOutcome::END;
+                    sessions.GetNextChunkAsync(ids[s], index, 0, &resp, &resp,
+                                               [&outcome](SessionManager::ChunkOutcome o) { outcome = o; });
+                    CHECK(outcome == SessionManager::ChunkOutcome::FOUND);
+                    CHECK(resp.chunk().size() == kChunkBytes);
+                    uint32_t part = 0;
+                    resp.chunk().copy(reinterpret_cast<char*>(&part), sizeof(part));
+                    CHECK(part == index);
+                    CHECK(resp.chunk().back() == tags[s]);
+                    (void)part;
+                    done++;
+                }
+            }
+            get_nexts += done;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    reading = false;
+    churn.join();
+
+    for (const auto& sid : ids) sessions.CleanupSession(sid);
+    return {seconds, get_nexts.load(), churned.load()};
+}
+
+}  // namespace
+
+int main() {
+    const int readers = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    const uint32_t sharded = SessionConfig().shards;
+
+    // SessionManager logs every chunk; keep that out of the measurement
+    std::cout.setstate(std::ios::badbit);
+    std::cerr.setstate(std::ios::badbit);
+    RunResult single = Run(1, readers);
+    RunResult multi = Run(sharded, readers);
+    std::cout.clear();
+    std::cerr.clear();
+
+    const long expected = static_cast<long>(kSessions) * kChunks;
+    CHECK(single.get_nexts == expected);
+    CHECK(multi.get_nexts == expected);
+
+    auto print = [](const char* name, const RunResult& r) {
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << r.get_nexts / r.seconds << " GetNext/s"
+                  << std::setw(10) << r.churned << " sessions churned" << std::endl;
+    };
+    std::cout << kSessions << " sessions x " << kChunks << " chunks, " << readers << " reader threads" << std::endl;
+    print("1 shard", single);
+    print((std::to_string(sharded) + " shards").c_str(), multi);
+    std::cout << "speedup " << std::setprecision(2) << single.seconds / multi.seconds << "x" << std::endl;
+
+    std::cout << "session_table_bench done (speedup varies from run to run; not checked)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,15 @@
+// test_check.h - Checks for the standalone test programs
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Kept in every build type: assert is compiled out under NDEBUG, and the tests are
+// built Release by scripts/build.sh
+#define CHECK(cond)                                                                    \
+    do {                                                                               \
+        if (!(cond)) {                                                                 \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+            std::exit(1);                                                              \
+        }                                                                              \
+    } while (0)